@@ -2,20 +2,272 @@
 #include "ndf_db.hpp"
 #include "ndf_properties.hpp"
 #include "sqlite_helpers.hpp"
+#include <algorithm>
+#include <charconv>
 #include <memory>
+#include <mutex>
+#include <numeric>
 #include <ranges>
+#include <unordered_map>
+#include <utility>
+
+static size_t hash_layout_names(std::span<const NDFName> names) {
+  size_t ret = names.size();
+  for (const auto &name : names) {
+    ret = ret * 31 + std::hash<NDFName>()(name);
+  }
+  return ret;
+}
+
+std::shared_ptr<const NDFPropertyLayout>
+NDFPropertyLayout::get(std::span<const NDFName> names) {
+  static std::mutex mutex;
+  // by hash of the names, the objects own the layouts
+  static std::unordered_multimap<size_t,
+                                 std::weak_ptr<const NDFPropertyLayout>>
+      layouts;
+  static size_t sweep_size = 64;
+  size_t hash = hash_layout_names(names);
+  std::lock_guard lock(mutex);
+  auto [begin, end] = layouts.equal_range(hash);
+  for (auto it = begin; it != end; ++it) {
+    auto layout = it->second.lock();
+    if (layout && std::ranges::equal(layout->names, names)) {
+      return layout;
+    }
+  }
+  // forget freed layouts whenever the pool doubled since the last time
+  if (layouts.size() >= sweep_size) {
+    std::erase_if(layouts,
+                  [](const auto &entry) { return entry.second.expired(); });
+    sweep_size = std::max<size_t>(64, layouts.size() * 2);
+  }
+  auto layout = std::make_shared<NDFPropertyLayout>();
+  layout->names.assign(names.begin(), names.end());
+  for (uint32_t i = 0; i < names.size(); i++) {
+    // the first property wins for duplicate names
+    layout->slots.emplace(names[i], i);
+  }
+  layouts.emplace(hash, layout);
+  return layout;
+}
+
+void NDFObject::update_layout() {
+  auto property_name = [](const NDFPropertyRef &property) {
+    return property->property_name;
+  };
+  // most modifications only change values, the layout stays the same then
+  if (layout && std::ranges::equal(layout->names, m_properties, {}, {},
+                                   property_name)) {
+    layout_modifications = modifications;
+    return;
+  }
+  std::vector<NDFName> names;
+  names.reserve(m_properties.size());
+  for (const auto &property : m_properties) {
+    names.push_back(property->property_name);
+  }
+  layout = NDFPropertyLayout::get(names);
+  layout_modifications = modifications;
+}
+
+NDFItem ndf_list_item(const NDFPropertyList &list, size_t i) {
+  if (!list.packed.empty()) {
+    auto item = [&]<typename T>() -> NDFItem {
+      using Traits = NDFValueTraits<T>;
+      return NDFValue(std::in_place_type<T>,
+                      Traits::from_words(list.packed.data() + i * Traits::words));
+    };
+    switch (list.packed_type) {
+    case NDFPropertyType::Int32:
+      return item.template operator()<int32_t>();
+    case NDFPropertyType::UInt32:
+      return item.template operator()<uint32_t>();
+    case NDFPropertyType::Float32:
+      return item.template operator()<float>();
+    case NDFPropertyType::F32_vec3:
+      return item.template operator()<std::array<float, 3>>();
+    default:
+      throw std::runtime_error(
+          std::format("Unknown packed NDFType: 0x{:02X}", list.packed_type));
+    }
+  }
+  if (!list.packed_values.empty()) {
+    return list.packed_values[i];
+  }
+  return *list.values()[i];
+}
+
+NDFPropertyPath::NDFPropertyPath(std::string_view path) : m_path(path) {
+  auto invalid = [&]() {
+    return std::runtime_error(std::format("Invalid property path {}", m_path));
+  };
+  size_t pos = 0;
+  while (true) {
+    size_t end = std::min(path.find('/', pos), path.size());
+    std::string_view segment = path.substr(pos, end - pos);
+    size_t bracket = segment.find('[');
+    std::string_view name = segment.substr(0, bracket);
+    if (name.empty()) {
+      throw invalid();
+    }
+    m_steps.push_back({.name = NDFName(name)});
+    while (bracket != std::string_view::npos) {
+      size_t close = segment.find(']', bracket);
+      if (close == std::string_view::npos || close == bracket + 1) {
+        throw invalid();
+      }
+      Step step;
+      step.key = segment.substr(bracket + 1, close - bracket - 1);
+      uint64_t index;
+      auto [ptr, ec] = std::from_chars(
+          step.key.data(), step.key.data() + step.key.size(), index);
+      if (ec == std::errc() && ptr == step.key.data() + step.key.size()) {
+        step.index = index;
+      }
+      m_steps.push_back(std::move(step));
+      bracket = close + 1;
+      if (bracket == segment.size()) {
+        bracket = std::string_view::npos;
+      } else if (segment[bracket] != '[') {
+        throw invalid();
+      }
+    }
+    if (end == path.size()) {
+      break;
+    }
+    pos = end + 1;
+  }
+}
+
+const NDFProperty *NDFPropertyPath::find_property(const Step &step,
+                                                  NDFObject &object) const {
+  if (!object.has_layout()) {
+    object.update_layout();
+  }
+  if (step.layout != object.layout) {
+    step.layout = object.layout;
+    step.slot = object.layout->find(*step.name);
+  }
+  if (step.slot == NDFPropertyLayout::no_slot) {
+    return nullptr;
+  }
+  return object.properties()[step.slot].get();
+}
+
+// map keys are compared as strings or as numbers
+static bool path_key_matches(const NDFItem &key, std::string_view text,
+                             std::optional<uint64_t> number) {
+  if (auto str = key.try_get<std::string_view>()) {
+    return *str == text;
+  }
+  auto equals = [&]<typename T>() {
+    auto value = key.try_get<T>();
+    return value && std::cmp_equal(*value, *number);
+  };
+  return number && (equals.template operator()<uint32_t>() ||
+                    equals.template operator()<int32_t>() ||
+                    equals.template operator()<uint16_t>() ||
+                    equals.template operator()<int16_t>() ||
+                    equals.template operator()<uint8_t>());
+}
+
+std::optional<NDFItem> NDFPropertyPath::resolve(NDF &ndf,
+                                                NDFObject &object) const {
+  if (!object.properties_loaded) {
+    ndf.load_object_properties(object);
+  }
+  NDFObject *current = &object;
+  std::optional<NDFItem> item;
+  for (const auto &step : m_steps) {
+    if (step.name) {
+      if (item) {
+        // continues in the referenced object
+        auto reference = item->try_get<NDFObjectValue>();
+        if (!reference) {
+          return std::nullopt;
+        }
+        uint32_t index = reference->object_index;
+        // packed references have no name to look up
+        if (index == NDFPropertyObjectReference::no_object && item->property) {
+          auto &by_name =
+              static_cast<const NDFPropertyObjectReference &>(*item->property);
+          index = ndf.get_object_index(by_name.object_name);
+        }
+        if (index >= ndf.object_map.size()) {
+          return std::nullopt;
+        }
+        current = &ndf.get_object_at(index);
+      }
+      const NDFProperty *property = find_property(step, *current);
+      if (!property) {
+        return std::nullopt;
+      }
+      item = NDFItem(*property);
+      continue;
+    }
+
+    // packed values have no items
+    if (!item->property) {
+      return std::nullopt;
+    }
+    const NDFProperty &property = *item->property;
+    if (property.property_type == NDFPropertyType::List) {
+      auto &list = static_cast<const NDFPropertyList &>(property);
+      if (!step.index || *step.index >= list.size()) {
+        return std::nullopt;
+      }
+      item = ndf_list_item(list, *step.index);
+    } else if (property.property_type == NDFPropertyType::Pair) {
+      auto &pair = static_cast<const NDFPropertyPair &>(property);
+      if (step.index != 0 && step.index != 1) {
+        return std::nullopt;
+      }
+      bool first = step.index == 0;
+      if (pair.is_packed()) {
+        item = NDFItem(first ? pair.packed_values->first
+                             : pair.packed_values->second);
+      } else {
+        item = NDFItem(first ? *pair.first : *pair.second);
+      }
+    } else if (property.property_type == NDFPropertyType::Map) {
+      auto &map = static_cast<const NDFPropertyMap &>(property);
+      std::optional<NDFItem> found;
+      for (const auto &[key, value] : map.packed_values) {
+        if (path_key_matches(key, step.key, step.index)) {
+          found = NDFItem(value);
+          break;
+        }
+      }
+      for (size_t i = 0; !found && !map.is_packed() && i < map.size(); i++) {
+        const auto &[key, value] = map.values()[i];
+        if (path_key_matches(*key, step.key, step.index)) {
+          found = NDFItem(*value);
+        }
+      }
+      if (!found) {
+        return std::nullopt;
+      }
+      item = found;
+    } else {
+      return std::nullopt;
+    }
+  }
+  return item;
+}
 
 void NDF::save_as_ndf_xml(fs::path path) {
+  load_all_objects();
   pugi::xml_document doc;
   auto root = doc.append_child("NDF");
 
-  for (const auto &[name, obj] : object_map) {
+  for (const auto &obj : objects()) {
     auto object_node = root.append_child(obj.name.c_str());
     object_node.append_attribute("class") = obj.class_name.c_str();
     object_node.append_attribute("export_path") = obj.export_path.c_str();
     object_node.append_attribute("is_top_object") = obj.is_top_object;
 
-    for (const auto &prop : obj.properties) {
+    for (const auto &prop : obj.properties()) {
       prop->to_ndf_xml(object_node);
     }
   }
@@ -25,6 +277,7 @@ void NDF::save_as_ndf_xml(fs::path path) {
 }
 
 void NDF::insert_into_db(NDF_DB *db, size_t ndf_id) {
+  load_all_objects();
   this->db = db;
   this->ndf_id = ndf_id;
   {
@@ -35,7 +288,7 @@ void NDF::insert_into_db(NDF_DB *db, size_t ndf_id) {
     auto begin = std::chrono::high_resolution_clock::now();
     {
       SQLTransaction trans(db->get_db());
-      for (auto &[name, object] : object_map) {
+      for (auto &object : objects()) {
         auto object_id_opt = db->insert_only_object(ndf_id, object);
         if (!object_id_opt) {
           spdlog::error("couldn't insert object!");
@@ -44,9 +297,11 @@ void NDF::insert_into_db(NDF_DB *db, size_t ndf_id) {
         }
         auto object_id = object_id_opt.value();
         spdlog::debug("inserted object {} into {}", object_id, ndf_id);
-        for (auto &property : object.properties) {
-          property->db_object_id = object_id;
-          db_property_map[property->property_type].push_back(property.get());
+        for (auto &property : object.m_properties) {
+          // shared properties belong to every object sharing them
+          NDFProperty &unique = property.edit();
+          unique.db_object_id = object_id;
+          db_property_map[unique.property_type].push_back(&unique);
         }
       }
     }
@@ -122,6 +377,81 @@ void NDF::insert_into_db(NDF_DB *db, size_t ndf_id) {
   spdlog::debug("finished NDF db");
 }
 
+void NDF::set_dedup_stats(
+    std::map<std::string, NDFDedupStats, std::less<>> stats) {
+  dedup_stats = std::move(stats);
+  NDFDedupStats total;
+  for (const auto &[class_name, class_stats] : dedup_stats) {
+    spdlog::debug("deduplicated {} properties of {}, saved {} bytes",
+                  class_stats.properties, class_name, class_stats.bytes);
+    total.properties += class_stats.properties;
+    total.bytes += class_stats.bytes;
+  }
+  spdlog::info("deduplicated {} properties, saved {} bytes", total.properties,
+               total.bytes);
+}
+
+const std::map<std::string, NDFDedupStats, std::less<>> &
+NDF::deduplicate_properties() {
+  load_all_objects();
+  NDFPropertyDeduplicator deduplicator;
+  for (auto &[name, object] : object_map) {
+    for (auto &property : object.m_properties) {
+      if (NDFPropertyDeduplicator::is_candidate(*property)) {
+        deduplicator.share(property, object.class_name);
+      }
+    }
+  }
+  set_dedup_stats(deduplicator.take_stats());
+  return dedup_stats;
+}
+
+uint32_t NDF::get_object_index(std::string_view name) const {
+  uint32_t index = object_map.index_of(name);
+  if (index != NDFSlabMap<NDFObject>::no_index) {
+    return index;
+  }
+  constexpr std::string_view prefix = "Object_";
+  if (!name.starts_with(prefix) || name.size() == prefix.size() ||
+      (name[prefix.size()] == '0' && name.size() > prefix.size() + 1)) {
+    return NDFSlabMap<NDFObject>::no_index;
+  }
+  const char *end = name.data() + name.size();
+  auto [ptr, ec] = std::from_chars(name.data() + prefix.size(), end, index);
+  // named objects were found above
+  if (ec != std::errc() || ptr != end || index >= object_map.size() ||
+      !object_map.nth(index).key().empty()) {
+    return NDFSlabMap<NDFObject>::no_index;
+  }
+  return index;
+}
+
+void NDF::add_object(NDFObject object) {
+  if (get_object_index(object.name) != NDFSlabMap<NDFObject>::no_index) {
+    return;
+  }
+  if (object.owner && object.owner != this) {
+    if (!object.properties_loaded) {
+      throw std::runtime_error(
+          std::format("Properties of object {} weren't decoded yet, it can't "
+                      "be moved to another NDF",
+                      object.name));
+    }
+    NDFArena::Scope arena_scope(get_arena());
+    for (auto &property : object.m_properties) {
+      property = property->get_copy();
+    }
+    // the loaded bytes and the schema counts belong to the other NDF
+    object.ndfbin_offset = 0;
+    object.ndfbin_size = 0;
+    object.schema_modifications = SIZE_MAX;
+    object.schema_class = NDFSymbolTable::no_index;
+    object.schema_layout.reset();
+  }
+  object.owner = this;
+  object_map.try_emplace(object.name, std::move(object));
+}
+
 void NDF::load_from_ndf_xml(fs::path path) {
   pugi::xml_document doc;
   pugi::xml_parse_result result = doc.load_file(path.c_str());
@@ -129,6 +459,7 @@ void NDF::load_from_ndf_xml(fs::path path) {
   assert(result.status == pugi::status_ok);
 
   spdlog::info("parsing NDF objects");
+  NDFArena::Scope arena_scope(get_arena());
   for (const auto &obj : doc.child("NDF").children()) {
     NDFObject object;
     object.name = obj.name();
@@ -151,80 +482,144 @@ void NDF::load_from_ndf_xml(fs::path path) {
 
     add_object(std::move(object));
   }
-  fill_gen_object();
 }
 
-void NDF::load_imprs(std::istream &stream,
-                     std::vector<std::string> current_import_path) {
-  uint32_t tran_index;
-  stream.read(reinterpret_cast<char *>(&tran_index), sizeof(uint32_t));
-  uint32_t index;
-  stream.read(reinterpret_cast<char *>(&index), sizeof(uint32_t));
-  uint32_t count;
-  stream.read(reinterpret_cast<char *>(&count), sizeof(uint32_t));
-
-  uint32_t begin_offset = (uint32_t)stream.tellg();
-  if (count > 0) {
-    std::vector<uint32_t> offsets;
-    offsets.resize(count);
-    stream.read(reinterpret_cast<char *>(offsets.data()),
-                sizeof(uint32_t) * count);
-
-    for (uint32_t offset : offsets) {
-      spdlog::debug("assertion @0x{:02X} is 0x{:02X} should be 0x{:02X}",
-                    begin_offset, ((uint32_t)stream.tellg() - begin_offset),
-                    offset);
-      assert(offset == ((uint32_t)stream.tellg() - begin_offset));
-      current_import_path.push_back(tran_table[tran_index]);
-      load_imprs(stream, current_import_path);
-      current_import_path.pop_back();
+void NDFSchema::assign_property_indices() {
+  for (auto &&[class_idx, clas] : class_properties | std::views::enumerate) {
+    const auto &names = clas.properties.items();
+    std::vector<uint32_t> order(names.size() - clas.property_indices.size());
+    std::iota(order.begin(), order.end(), clas.property_indices.size());
+    std::sort(order.begin(), order.end(),
+              [&](uint32_t a, uint32_t b) { return names[a] < names[b]; });
+    clas.property_indices.resize(names.size());
+    for (uint32_t i : order) {
+      properties.emplace_back(names[i], class_idx);
+      clas.property_indices[i] = properties.size() - 1;
     }
   }
+}
 
-  if (index == 4294967295) {
-    return;
+void NDFSchema::drop_unused_properties() {
+  std::vector<uint32_t> new_indices(properties.size(),
+                                    NDFSymbolTable::no_index);
+  std::vector<std::pair<std::string, uint32_t>> kept_properties;
+  for (auto &&[prop_idx, property] : properties | std::views::enumerate) {
+    const auto &clas = class_properties[property.second];
+    if (prop_idx < loaded_properties ||
+        clas.users[clas.properties.find(property.first)] > 0) {
+      new_indices[prop_idx] = kept_properties.size();
+      kept_properties.push_back(std::move(property));
+    }
   }
+  properties = std::move(kept_properties);
 
-  auto foo = current_import_path | std::views::join_with('/');
-  std::string tmp(foo.begin(), foo.end());
-  import_name_table[index] = tmp + std::string("/") + tran_table[tran_index];
-  spdlog::debug("Import: {}", import_name_table[index]);
+  for (auto &clas : class_properties) {
+    // properties with a PROP index come first, that doesn't change
+    NDFClass kept;
+    for (auto &&[idx, name] : clas.properties.items() | std::views::enumerate) {
+      bool loaded = idx < clas.property_indices.size() &&
+                    clas.property_indices[idx] < loaded_properties;
+      if (clas.users[idx] == 0 && !loaded) {
+        continue;
+      }
+      kept.properties.get_or_add(name);
+      kept.users.push_back(clas.users[idx]);
+      if (idx < clas.property_indices.size()) {
+        kept.property_indices.push_back(
+            new_indices[clas.property_indices[idx]]);
+      }
+    }
+    clas = std::move(kept);
+  }
+}
+
+bool NDF::schema_matches(const NDFObject &object) const {
+  // the properties can't change without modifications
+  return object.schema_modifications == object.modifications &&
+         schema.find_class(object.class_name) == object.schema_class;
 }
 
-void NDF::load_exprs(std::istream &stream,
-                     std::vector<std::string> current_export_path) {
-  uint32_t tran_index;
-  stream.read(reinterpret_cast<char *>(&tran_index), sizeof(uint32_t));
-  uint32_t index;
-  stream.read(reinterpret_cast<char *>(&index), sizeof(uint32_t));
-  uint32_t count;
-  stream.read(reinterpret_cast<char *>(&count), sizeof(uint32_t));
-
-  uint32_t begin_offset = (uint32_t)stream.tellg();
-  if (count > 0) {
-    std::vector<uint32_t> offsets;
-    offsets.resize(count);
-    stream.read(reinterpret_cast<char *>(offsets.data()),
-                sizeof(uint32_t) * count);
-
-    for (uint32_t offset : offsets) {
-      assert(offset == ((uint32_t)stream.tellg() - begin_offset));
-      current_export_path.push_back(tran_table[tran_index]);
-      load_exprs(stream, current_export_path);
-      current_export_path.pop_back();
+bool NDF::remove_from_schema(const NDFObject &object) {
+  bool unused = false;
+  if (object.schema_layout) {
+    for (const auto &name : object.schema_layout->names) {
+      unused = schema.remove_property(object.schema_class, name) || unused;
     }
+    return unused;
   }
+  // counted from the loaded file, with the classes of its PROP table
+  for_each_ndfbin_property(object, [&](uint32_t property_idx, uint32_t) {
+    const auto &[name, class_idx] = property_table.at(property_idx);
+    unused = schema.remove_property(
+                 schema.find_class(class_table.at(class_idx)), name) ||
+             unused;
+  });
+  return unused;
+}
 
-  if (index == 4294967295) {
-    return;
+void NDF::update_schema() {
+  bool unused = false;
+  for (auto it = object_map.begin(); it != object_map.end(); ++it) {
+    auto &obj = it.value();
+    bool counted = obj.schema_modifications != SIZE_MAX;
+    if (counted && schema_matches(obj)) {
+      continue;
+    }
+    if (!obj.properties_loaded) {
+      load_object_properties(obj);
+    }
+    // the new properties are counted first, so properties the object keeps
+    // never look unused
+    uint32_t class_idx = schema.add_class(obj.class_name);
+    for (auto &property : obj.properties()) {
+      schema.add_property(class_idx, property->property_name);
+    }
+    if (counted) {
+      unused = remove_from_schema(obj) || unused;
+    }
+    if (!obj.has_layout()) {
+      obj.update_layout();
+    }
+    obj.schema_class = class_idx;
+    obj.schema_layout = obj.layout;
+    obj.schema_modifications = obj.modifications;
+  }
+  if (unused) {
+    schema.drop_unused_properties();
   }
+  schema.assign_property_indices();
+}
+
+void NDF::rebuild_schema() {
+  schema.clear();
+  for (auto it = object_map.begin(); it != object_map.end(); ++it) {
+    auto &obj = it.value();
+    obj.schema_modifications = SIZE_MAX;
+    obj.schema_layout.reset();
+  }
+  update_schema();
+}
 
-  auto &obj = get_object(gen_object_items[index]);
+void NDF::load_imprs(NDFBinReader &reader) {
+  NDFPathTrie paths;
+  paths.read_ndfbin(reader);
+  paths.for_each_indexed([&](uint32_t node, uint32_t index) {
+    import_name_table[index] = paths.get_path(node, tran_table);
+    spdlog::debug("Import: {}", import_name_table[index]);
+  });
+}
 
-  auto test = current_export_path | std::views::join_with('/');
-  std::string tmp(test.begin(), test.end());
-  obj.export_path = tmp + std::string("/") + tran_table[tran_index];
-  spdlog::debug("Export: {}", obj.export_path);
+void NDF::load_exprs(NDFBinReader &reader) {
+  NDFPathTrie paths;
+  paths.read_ndfbin(reader);
+  paths.for_each_indexed([&](uint32_t node, uint32_t index) {
+    if (index >= object_map.size()) {
+      throw std::runtime_error("ndfbin: EXPR references unknown object");
+    }
+    auto &obj = object_map.get(index);
+    obj.export_path = paths.get_path(node, tran_table);
+    spdlog::debug("Export: {}", obj.export_path);
+  });
 }
 
 std::optional<NDFObject> NDF::get_object(size_t id) {
@@ -250,7 +645,7 @@ void NDF::load_from_db(NDF_DB *db, size_t ndf_id) {
       }
       auto &objects = objects_opt.value();
       for (auto &object : objects) {
-        object_map.emplace(object.name, std::move(object));
+        add_object(std::move(object));
       }
     }
     auto end = std::chrono::high_resolution_clock::now();
@@ -262,13 +657,17 @@ void NDF::load_from_db(NDF_DB *db, size_t ndf_id) {
   {
     auto begin = std::chrono::high_resolution_clock::now();
     {
+      NDFArena::Scope arena_scope(get_arena());
       auto object_it = object_map.begin();
       while (object_it != object_map.end()) {
         std::optional<std::vector<std::unique_ptr<NDFProperty>>>
             properties_opt = db->get_only_properties(object_it->second.db_id);
         if (properties_opt.has_value()) {
           spdlog::debug("loaded {} properties", properties_opt.value().size());
-          object_it.value().properties = std::move(properties_opt.value());
+          auto &properties = properties_opt.value();
+          object_it.value().assign_properties(
+              std::make_move_iterator(properties.begin()),
+              std::make_move_iterator(properties.end()));
         } else {
           spdlog::error("failed to get properties from db");
           return;
@@ -1,19 +1,31 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
+#include <format>
 #include <map>
+#include <memory>
+#include <optional>
 #include <ranges>
-#include <set>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
-#include "tsl/ordered_map.h"
-
 #include "spdlog/spdlog.h"
 
 #include "pugixml.hpp"
 
+#include "ndf_accessors.hpp"
+#include "ndf_dedup.hpp"
+#include "ndf_path_trie.hpp"
 #include "ndf_properties.hpp"
+#include "ndf_slab_map.hpp"
+#include "ndf_symbol_table.hpp"
+#include "ndfbin_reader.hpp"
+#include "ndfbin_visitor.hpp"
+#include "ndfbin_writer.hpp"
 
 #include <filesystem>
 namespace fs = std::filesystem;
@@ -21,43 +33,347 @@ namespace fs = std::filesystem;
 using namespace std::literals;
 
 struct NDF;
+struct TOCTable;
 
 struct NDFClass {
-  std::map<std::string, uint32_t> properties;
+  // property names in order of first appearance
+  NDFSymbolTable properties;
+  // PROP index for every entry of properties
+  std::vector<uint32_t> property_indices;
+  // number of objects using every entry of properties
+  std::vector<uint32_t> users;
+};
+
+// the classes and properties written to CLAS and PROP. NDF keeps it across
+// saves and only walks new or modified objects to update it, properties are
+// dropped once no object uses them anymore, except for the PROP table of a
+// loaded file. see NDF::get_schema
+struct NDFSchema {
+  // class names in CLAS order
+  NDFSymbolTable classes;
+  // properties of every class, indexed like classes
+  std::vector<NDFClass> class_properties;
+  // the PROP table, property name and class index
+  std::vector<std::pair<std::string, uint32_t>> properties;
+  // the first entries of properties came from the PROP table of a loaded
+  // file, they keep their index until clear() even without users
+  uint32_t loaded_properties = 0;
+
+  uint32_t find_class(std::string_view name) const {
+    return classes.find(name);
+  }
+  // PROP index of a property, NDFSymbolTable::no_index if it's unknown
+  uint32_t find_property(uint32_t class_idx, std::string_view name) const {
+    if (class_idx >= class_properties.size()) {
+      return NDFSymbolTable::no_index;
+    }
+    const auto &clas = class_properties[class_idx];
+    uint32_t idx = clas.properties.find(name);
+    if (idx >= clas.property_indices.size()) {
+      return NDFSymbolTable::no_index;
+    }
+    return clas.property_indices[idx];
+  }
+
+  uint32_t add_class(std::string_view name) {
+    uint32_t ret = classes.get_or_add(name);
+    if (ret >= class_properties.size()) {
+      class_properties.resize(ret + 1);
+    }
+    return ret;
+  }
+  // counts an object using the property, the PROP index of new properties
+  // is assigned later by assign_property_indices
+  void add_property(uint32_t class_idx, std::string_view name,
+                    uint32_t count = 1) {
+    auto &clas = class_properties[class_idx];
+    uint32_t idx = clas.properties.get_or_add(name);
+    if (idx >= clas.users.size()) {
+      clas.users.resize(idx + 1);
+    }
+    clas.users[idx] += count;
+  }
+  // counts an object less using the property, true if no object uses it
+  // anymore. it stays in the schema until drop_unused_properties
+  bool remove_property(uint32_t class_idx, std::string_view name) {
+    if (class_idx >= class_properties.size()) {
+      return false;
+    }
+    auto &clas = class_properties[class_idx];
+    uint32_t idx = clas.properties.find(name);
+    if (idx >= clas.users.size() || clas.users[idx] == 0) {
+      return false;
+    }
+    return --clas.users[idx] == 0;
+  }
+  // adds a property with the next PROP index and no users, used for loaded
+  // PROP tables
+  void add_indexed_property(uint32_t class_idx, std::string_view name) {
+    auto &clas = class_properties[class_idx];
+    if (clas.properties.get_or_add(name) == clas.property_indices.size()) {
+      clas.property_indices.push_back(properties.size());
+      clas.users.push_back(0);
+      properties.emplace_back(name, class_idx);
+      loaded_properties = properties.size();
+    }
+  }
+  // removes all properties without users that weren't loaded, the PROP
+  // indices of the remaining ones keep their order
+  void drop_unused_properties();
+  // appends all properties without an index to PROP, sorted by name within
+  // every class
+  void assign_property_indices();
+
+  void clear() {
+    classes.clear();
+    class_properties.clear();
+    properties.clear();
+    loaded_properties = 0;
+  }
+};
+
+// result of NDF::probe_ndfbin, only filled from the header, the TOC and the
+// sections requested in NDFBinProbeOptions
+struct NDFBinProbeOptions {
+  bool classes = false;
+  bool properties = false;
+  bool chunks = true;
+};
+
+struct NDFBinSection {
+  std::string name;
+  uint32_t offset = 0;
+  uint32_t size = 0;
+};
+
+struct NDFBinSummary {
+  fs::path path;
+  // set if probing failed, everything else may be incomplete then
+  std::string error;
+  bool compressed = false;
+  uint32_t size = 0;
+  std::vector<NDFBinSection> sections;
+  // object count from CHNK
+  std::optional<uint32_t> object_count;
+  std::vector<std::string> class_names;
+  // property name and class index, as in the PROP table
+  std::vector<std::pair<std::string, uint32_t>> property_names;
+};
+
+// property names of an object in property order, shared by all objects with
+// the same properties in the same order, which are mostly the objects of one
+// class. layouts are interned like NDFName, but freed with the last object
+// using them.
+struct NDFPropertyLayout {
+  static constexpr uint32_t no_slot = UINT32_MAX;
+
+  std::vector<NDFName> names;
+  std::unordered_map<NDFName, uint32_t> slots;
+
+  // index into NDFObject::properties(), no_slot if there is no such property
+  uint32_t find(NDFName name) const {
+    auto it = slots.find(name);
+    return it == slots.end() ? no_slot : it->second;
+  }
+  // the shared layout for names
+  static std::shared_ptr<const NDFPropertyLayout>
+  get(std::span<const NDFName> names);
 };
 
 struct NDFObject {
+  NDFObject() = default;
+  // properties may be allocated from the arenas of the NDF owning the object,
+  // use get_copy or clone instead
+  NDFObject(const NDFObject &) = delete;
+  NDFObject &operator=(const NDFObject &) = delete;
+  NDFObject(NDFObject &&) = default;
+  NDFObject &operator=(NDFObject &&) = default;
+
   std::string name;
   std::string class_name;
-  bool is_top_object;
+  bool is_top_object = false;
   std::string export_path;
-  std::vector<std::unique_ptr<NDFProperty>> properties;
-  std::map<std::string, uint32_t> property_map;
-  std::unique_ptr<NDFProperty> &get_property(const std::string &name) {
-    return properties.at(property_map.at(name));
+
+private:
+  // may be shared with clones of this object, see clone
+  std::vector<NDFPropertyRef> m_properties;
+  // decoding, deduplication and the db ids don't count as modifications
+  friend struct NDF;
+  friend class NDF_DB;
+
+public:
+  // read only, changes go through edit_property, add_property,
+  // remove_property and assign_properties
+  const std::vector<NDFPropertyRef> &properties() const { return m_properties; }
+  // resolves property names to indices into properties, checked on the next
+  // lookup after modifications changed (or the object was decoded) and only
+  // replaced if the property names changed
+  std::shared_ptr<const NDFPropertyLayout> layout;
+  size_t layout_modifications = 0;
+
+  // index of the property, NDFPropertyLayout::no_slot if there is none.
+  // resolve names to NDFName once when looking them up in many objects.
+  uint32_t find_property(NDFName name) {
+    if (!has_layout()) {
+      update_layout();
+    }
+    return layout->find(name);
+  }
+  // names that were never interned can't be found, so this doesn't intern
+  uint32_t find_property(std::string_view name) {
+    auto interned = NDFName::find(name);
+    return interned ? find_property(*interned) : NDFPropertyLayout::no_slot;
   }
+  // read only, throws std::out_of_range if there is no such property
+  const NDFProperty &get_property(NDFName name) {
+    return *get_property_at(find_property(name), name);
+  }
+  const NDFProperty &get_property(std::string_view name) {
+    return *get_property_at(find_property(name), name);
+  }
+  // the property for changing it, copied first if it's shared with a clone.
+  // the copy is of the whole property, changing one item of a shared list or
+  // map copies all of its items. counts as a modification of the object. the
+  // only way to change a property in place, see modifications
+  NDFProperty &edit_property(uint32_t slot) {
+    auto &property = m_properties.at(slot).edit();
+    modifications++;
+    return property;
+  }
+  NDFProperty &edit_property(NDFName name) {
+    return edit_property_at(find_property(name), name);
+  }
+  NDFProperty &edit_property(std::string_view name) {
+    return edit_property_at(find_property(name), name);
+  }
+  // typed value of a property, see ndf_get. throws std::out_of_range if
+  // there is no such property, std::runtime_error if it has another type or
+  // the object wasn't decoded yet
+  template <NDFAccessible T> T get(NDFName name) {
+    return ndf_get<T>(get_property(name));
+  }
+  template <NDFAccessible T> T get(std::string_view name) {
+    return ndf_get<T>(get_property(name));
+  }
+  // the items of a list property, see NDFListView
+  template <NDFAccessible T> NDFListView<T> get_list(NDFName name) {
+    return ndf_get_list<T>(get_property(name));
+  }
+  template <NDFAccessible T> NDFListView<T> get_list(std::string_view name) {
+    return ndf_get_list<T>(get_property(name));
+  }
+  bool has_layout() const {
+    return layout && layout_modifications == modifications &&
+           layout->names.size() == m_properties.size();
+  }
+  void update_layout();
 
   // DB
   size_t db_id = 0;
   size_t db_ndf_id = 0;
+  // incremented by every change of the properties. changes to the other
+  // members have to increment it by hand, otherwise an incremental save
+  // copies the original bytes, see NDF::save_as_ndfbin_stream
   size_t modifications = 0;
+  // value of modifications when the properties were added to the schema of
+  // the NDF, SIZE_MAX if they weren't. see NDF::get_schema
+  size_t schema_modifications = SIZE_MAX;
+  // class and property names the object is counted with in the schema. the
+  // layout is null for objects counted from the loaded ndfbin
+  uint32_t schema_class = NDFSymbolTable::no_index;
+  std::shared_ptr<const NDFPropertyLayout> schema_layout;
+
+  // lazy ndfbin loading: properties are decoded from ndfbin_offset (first
+  // property of the object in the ndfbin buffer) on first access through NDF
+  bool properties_loaded = true;
+  uint32_t ndfbin_offset = 0;
+  // size of the properties including the terminator, 0 if the object wasn't
+  // loaded from ndfbin
+  uint32_t ndfbin_size = 0;
+  // the NDF the object was added to, its properties may be allocated from
+  // the arenas of that NDF. adding the object to another NDF copies them,
+  // see NDF::add_object
+  const NDF *owner = nullptr;
 
 public:
+  // both throw for lazily loaded objects that weren't decoded yet, get them
+  // through NDF::get_object or NDF::objects() first
   NDFObject get_copy() {
+    require_properties_loaded();
+    NDFObject ret;
+    ret.name = name;
+    ret.class_name = class_name;
+    ret.is_top_object = is_top_object;
+    ret.export_path = export_path;
+    for (auto const &prop : m_properties) {
+      ret.m_properties.push_back(prop->get_copy());
+    }
+    if (has_layout()) {
+      ret.layout = layout;
+      ret.layout_modifications = ret.modifications;
+    }
+    return ret;
+  }
+  // copy that shares all properties with this object instead of copying
+  // them, a property is only copied once either object changes it through
+  // edit_property. costs one reference per property, the properties vector
+  // itself isn't shared. adding the clone to another NDF copies the
+  // properties.
+  NDFObject clone() const {
+    require_properties_loaded();
     NDFObject ret;
     ret.name = name;
     ret.class_name = class_name;
     ret.is_top_object = is_top_object;
     ret.export_path = export_path;
-    for (auto const &prop : properties) {
-      ret.property_map.insert({prop->property_name, ret.properties.size()});
-      ret.properties.push_back(prop->get_copy());
+    ret.m_properties = m_properties;
+    ret.owner = owner;
+    if (has_layout()) {
+      ret.layout = layout;
+      ret.layout_modifications = ret.modifications;
     }
     return ret;
   }
-  void add_property(std::unique_ptr<NDFProperty> property) {
-    property_map.insert({property->property_name, properties.size()});
-    properties.push_back(std::move(property));
+  // all count as a modification of the object
+  void add_property(NDFPropertyRef property) {
+    m_properties.push_back(std::move(property));
+    modifications++;
+  }
+  void remove_property(uint32_t slot) {
+    if (slot >= m_properties.size()) {
+      throw std::out_of_range(
+          std::format("Object {} has no property {}", name, slot));
+    }
+    m_properties.erase(m_properties.begin() + slot);
+    modifications++;
+  }
+  // replaces all properties
+  template <typename It> void assign_properties(It first, It last) {
+    m_properties.assign(first, last);
+    modifications++;
+  }
+
+private:
+  void require_properties_loaded() const {
+    if (!properties_loaded) {
+      throw std::runtime_error(std::format(
+          "Properties of object {} weren't decoded yet", this->name));
+    }
+  }
+  const NDFPropertyRef &get_property_at(uint32_t slot,
+                                        std::string_view name) {
+    // an undecoded object has no properties yet, that's not a missing one
+    require_properties_loaded();
+    if (slot == NDFPropertyLayout::no_slot) {
+      throw std::out_of_range(
+          std::format("Object {} has no property {}", this->name, name));
+    }
+    return m_properties[slot];
+  }
+  NDFProperty &edit_property_at(uint32_t slot, std::string_view name) {
+    // throws for missing properties
+    get_property_at(slot, name);
+    return edit_property(slot);
   }
 };
 
@@ -67,25 +383,52 @@ private:
   size_t ndf_id = 0;
   size_t ndf_modifications = 0;
   std::unordered_map<uint32_t, std::vector<NDFProperty *>> db_property_map;
+  // memory of the properties created by this NDF, declared before object_map
+  // so the objects are destroyed first. decoding ndfbin in parallel adds one
+  // arena per thread.
+  std::vector<std::unique_ptr<NDFArena>> arenas;
+  NDFArena *add_arena(size_t chunk_size = 64 * 1024) {
+    arenas.push_back(std::make_unique<NDFArena>(chunk_size));
+    return arenas.back().get();
+  }
+  // arena for everything not decoded by decode_ndfbin_objects
+  NDFArena *get_arena() {
+    if (arenas.empty()) {
+      add_arena();
+    }
+    return arenas.front().get();
+  }
+  // backing memory of the last loaded ndfbin, the string tables below are
+  // views into it
+  std::unique_ptr<NDFBinBuffer> ndfbin_buffer;
+
+  // loads CLAS/STRG/TRAN/PROP/IMPR
+  void load_ndfbin_tables(const NDFBinReader &file, const TOCTable &toc);
+  void visit_ndfbin_buffer(std::unique_ptr<NDFBinBuffer> buffer,
+                           NDFBinVisitor &visitor);
 
 public:
   std::map<unsigned int, std::string> import_name_table;
-  std::vector<std::string> string_table;
-  std::vector<std::string> class_table;
-  std::vector<std::pair<std::string, uint32_t>> property_table;
-  std::vector<std::string> tran_table;
-  tsl::ordered_map<std::string, NDFObject> object_map;
+  std::vector<std::string_view> string_table;
+  std::vector<std::string_view> class_table;
+  // property names are interned once per load, the decoded properties share
+  // them, see NDFName
+  std::vector<std::pair<NDFName, uint32_t>> property_table;
+  std::vector<std::string_view> tran_table;
+  // objects in ndfbin order, the index of an object is its ndfbin object
+  // index. objects never move, references stay valid while adding objects
+  NDFSlabMap<NDFObject> object_map;
 
   void save_as_ndf_xml(fs::path path);
-  void load_imprs(std::istream &stream,
-                  std::vector<std::string> current_import_path);
-  void load_exprs(std::istream &stream,
-                  std::vector<std::string> current_export_path);
+  void load_imprs(NDFBinReader &reader);
+  void load_exprs(NDFBinReader &reader);
   void load_from_ndf_xml(fs::path path);
 
-  void add_object(NDFObject object) {
-    object_map.insert({object.name, std::move(object)});
-  }
+  // ignored if there already is an object with the same name. objects of
+  // another NDF get their properties copied into the arena of this one, so
+  // they stay valid after the other NDF is cleared. throws for lazily loaded
+  // objects of another NDF that weren't decoded yet.
+  void add_object(NDFObject object);
 
   // used for saving to the db
   void insert_into_db(NDF_DB *db, size_t ndf_id);
@@ -99,133 +442,209 @@ public:
   }
 
 private:
-  std::vector<std::string> gen_object_items;
-  std::map<std::string, uint32_t> gen_object_table;
-
-  std::vector<std::string> gen_string_items;
-  std::map<std::string, uint32_t> gen_string_table;
-
-  std::map<std::string, uint32_t> gen_clas_items;
-  std::vector<std::string> gen_clas_table;
-
+  NDFSymbolTable gen_strings;
   std::vector<uint32_t> gen_topo_table;
-
-  std::map<std::string, uint32_t> gen_tran_items;
-  std::vector<std::string> gen_tran_table;
-
-  std::map<std::vector<uint32_t>, uint32_t> gen_import_table;
-  std::vector<std::vector<uint32_t>> gen_import_items;
-  std::map<std::vector<uint32_t>, uint32_t> gen_export_table;
-  std::vector<std::vector<uint32_t>> gen_export_items;
-
-  std::vector<NDFClass> gen_property_table;
-  std::vector<std::pair<std::string, uint32_t>> gen_property_items;
-  std::set<std::pair<std::string, uint32_t>> gen_property_set;
-
-  void
-  save_ndfbin_imprs(const std::map<std::vector<uint32_t>, uint32_t> &gen_table,
-                    std::ostream &stream);
-
-  // gets called by every save_as_ndfbin
-  void fill_gen_object() {
-    for (const auto &[idx, it] : object_map | std::views::enumerate) {
-      gen_object_items.push_back(it.second.name);
-      gen_object_table.insert({it.second.name, gen_object_items.size() - 1});
-    }
+  NDFSymbolTable gen_trans;
+
+  NDFPathTrie gen_import_paths;
+  uint32_t gen_import_count = 0;
+  NDFPathTrie gen_export_paths;
+
+  NDFSchema schema;
+  std::map<std::string, NDFDedupStats, std::less<>> dedup_stats;
+  void set_dedup_stats(std::map<std::string, NDFDedupStats, std::less<>> stats);
+  // adds the classes and properties of new or modified objects to schema and
+  // drops the ones no object uses anymore
+  void update_schema();
+  // false if the object changed since it was counted in schema
+  bool schema_matches(const NDFObject &object) const;
+  // counts the object less in schema, true if that left unused properties
+  bool remove_from_schema(const NDFObject &object);
+
+  // class index of every object, indexed like object_map
+  std::vector<uint32_t> gen_object_classes;
+  // set for unchanged objects during an incremental save
+  std::vector<bool> gen_object_unchanged;
+
+  void clear_gen_tables() {
+    gen_object_classes.clear();
+    gen_object_unchanged.clear();
+    gen_strings.clear();
+    gen_topo_table.clear();
+    gen_trans.clear();
+    gen_import_paths.clear();
+    gen_import_count = 0;
+    gen_export_paths.clear();
   }
-
-  // used for object reference
-  uint32_t get_object_index(const std::string &name) {
-    auto obj_idx = gen_object_table.find(name);
-    if (obj_idx == gen_object_table.end()) {
-      return 4294967295;
+  // calls f(property_idx, ndf_type) for every property of an object as it is
+  // stored in the loaded ndfbin, without decoding the values
+  template <typename F>
+  void for_each_ndfbin_property(const NDFObject &object, F f) const {
+    NDFBinReader reader(ndfbin_buffer->data());
+    reader.seek(object.ndfbin_offset);
+    while (true) {
+      uint32_t property_idx = reader.read<uint32_t>();
+      if (property_idx == 2880154539) {
+        break;
+      }
+      uint32_t ndf_type = reader.read<uint32_t>();
+      f(property_idx, ndf_type);
+      NDFProperty::skip_ndfbin(ndf_type, reader);
     }
-    return obj_idx->second;
   }
+  // fills the gen tables with the tables of the loaded ndfbin, so indices in
+  // the original object data stay valid. fails if the tables can't be
+  // reproduced, e.g. because of duplicate strings
+  bool seed_gen_tables();
+
+  // used for object references by name, safe to call from multiple threads.
+  // unnamed objects are found by the name get_object_name gives them
+  uint32_t get_object_index(std::string_view name) const;
   // used for object references
-  uint32_t get_class_of_object(const std::string &name) {
-    auto object_idx = get_object_index(name);
-    if (object_idx == 4294967295) {
+  uint32_t get_class_of_object(uint32_t object_idx) {
+    if (object_idx >= gen_object_classes.size()) {
       return 4294967295;
     }
-    return get_class(get_object(name).class_name);
+    return gen_object_classes[object_idx];
   }
 
-  uint32_t get_class(const std::string &str) {
-    auto obj_idx = gen_clas_items.find(str);
-    if (obj_idx == gen_clas_items.end()) {
-      return 4294967295;
-    }
-    return obj_idx->second;
-  }
   friend struct NDFPropertyObjectReference;
   friend struct NDFPropertyImportReference;
+  friend class NDFPropertyPath;
+
+  // decodes the properties of a lazily loaded object
+  void load_object_properties(NDFObject &object);
+  void decode_ndfbin_properties(NDFObject &object, NDFBinReader &reader,
+                                NDFPropertyDeduplicator *deduplicator = nullptr);
+  // decodes the properties of all objects, split over multiple threads for
+  // large files. only reads the tables of this NDF, so it is safe to call
+  // decode_ndfbin_properties concurrently
+  void decode_ndfbin_objects(const NDFBinReader &obje, uint32_t obje_offset,
+                             NDFPropertyDeduplicator *deduplicator);
+  void save_ndfbin_object(NDFBinWriter &writer, uint32_t obj_idx,
+                          const NDFObject &obj);
+  // writes OBJE, split over multiple threads for large files
+  void save_ndfbin_objects(NDFBinWriter &writer);
 
 public:
-  NDFObject &get_object(const std::string &str) { return object_map.at(str); }
-
-private:
-  uint32_t get_or_add_string(const std::string &str) {
-    auto it = gen_string_table.find(str);
-    if (it == gen_string_table.end()) {
-      gen_string_items.push_back(str);
-      gen_string_table.insert({str, gen_string_items.size() - 1});
-      return gen_string_items.size() - 1;
-    } else {
-      return it->second;
+  // throws std::out_of_range if there is no such object
+  NDFObject &get_object(std::string_view name) {
+    uint32_t index = get_object_index(name);
+    if (index == NDFSlabMap<NDFObject>::no_index) {
+      throw std::out_of_range(std::format("Unknown object {}", name));
     }
+    return get_object_at(index);
   }
-
-  uint32_t get_or_add_tran(const std::string &str) {
-    auto it = gen_tran_items.find(str);
-    if (it == gen_tran_items.end()) {
-      gen_tran_table.push_back(str);
-      gen_tran_items.insert({str, gen_tran_table.size() - 1});
-      return gen_tran_table.size() - 1;
-    } else {
-      return it->second;
+  // the object with the given index in object_map, e.g. of an object
+  // reference loaded from ndfbin
+  NDFObject &get_object_at(size_t index) {
+    auto &object = object_map.get(index);
+    if (object.name.empty()) {
+      object.name = get_object_name(index);
+    }
+    if (!object.properties_loaded) {
+      load_object_properties(object);
     }
+    return object;
+  }
+  // objects loaded from ndfbin are named after their index like object
+  // references. the name is only stored in the object once it is accessed
+  // through get_object, get_object_at or objects(), they stay out of the
+  // name index of object_map
+  std::string get_object_name(size_t index) const {
+    const auto &object = object_map.get(index);
+    return object.name.empty() ? "Object_" + std::to_string(index)
+                               : object.name;
+  }
+  // decodes all objects not yet decoded by a lazy load
+  void load_all_objects();
+
+  // shares identical list, map and pair properties between all objects,
+  // see NDFPropertyDeduplicator. returns what was saved per class, also
+  // logged and kept until the next deduplication
+  const std::map<std::string, NDFDedupStats, std::less<>> &
+  deduplicate_properties();
+  const std::map<std::string, NDFDedupStats, std::less<>> &
+  get_dedup_stats() const {
+    return dedup_stats;
   }
 
-  uint32_t get_or_add_impr_indices(const std::vector<uint32_t> &vec) {
-    auto it = gen_import_table.find(vec);
-    if (it == gen_import_table.end()) {
-      gen_import_items.push_back(vec);
-      gen_import_table.insert({vec, gen_import_items.size() - 1});
-      return gen_import_items.size() - 1;
-    } else {
-      return it->second;
+  // classes and properties as they would be written by the next save. only
+  // new objects and objects that changed since the last call are walked,
+  // loaded ndfbin files start with their own CLAS/PROP tables. properties
+  // are dropped with the last object using them unless they are part of the
+  // loaded PROP table, classes are kept.
+  const NDFSchema &get_schema() {
+    update_schema();
+    return schema;
+  }
+  // builds the schema again from all objects, which drops unused classes and
+  // the PROP table of a loaded file
+  void rebuild_schema();
+
+  // iterates all objects in order, lazily loaded objects get decoded and
+  // named when the iteration reaches them
+  struct ObjectIterator {
+    NDF *ndf;
+    NDFSlabMap<NDFObject>::iterator it;
+    NDFObject &operator*() const { return ndf->get_object_at(it.index()); }
+    ObjectIterator &operator++() {
+      ++it;
+      return *this;
     }
+    bool operator==(const ObjectIterator &other) const {
+      return it == other.it;
+    }
+  };
+  struct ObjectRange {
+    NDF *ndf;
+    ObjectIterator begin() { return {ndf, ndf->object_map.begin()}; }
+    ObjectIterator end() { return {ndf, ndf->object_map.end()}; }
+  };
+  ObjectRange objects() { return {this}; }
+
+private:
+  uint32_t get_or_add_string(std::string_view str) {
+    return gen_strings.get_or_add(str);
   }
 
-  uint32_t get_or_add_impr(std::string impr) {
-    std::vector<uint32_t> vec;
-    for (auto str : std::views::split(impr, '/')) {
-      std::string foo = std::string(str.begin(), str.end());
-      vec.push_back(get_or_add_tran(foo));
+  // the indices to_ndfbin writes, these are provisional while a chunk of
+  // objects is written in parallel, see save_ndfbin_objects
+  uint32_t get_string_index(NDFBinWriter &writer, std::string_view str) {
+    if (writer.local_symbols) {
+      return writer.local_symbols->strings.get_or_add(str, writer.tell());
     }
-    return get_or_add_impr_indices(vec);
-  }
-
-  uint32_t get_or_add_expr_indices(const std::vector<uint32_t> &vec,
-                                   uint32_t object_idx) {
-    auto it = gen_export_table.find(vec);
-    if (it == gen_export_table.end()) {
-      gen_export_items.push_back(vec);
-      gen_export_table.insert({vec, object_idx});
-      return gen_export_items.size() - 1;
-    } else {
-      return it->second;
+    return get_or_add_string(str);
+  }
+  uint32_t get_import_index(NDFBinWriter &writer, std::string_view impr) {
+    if (writer.local_symbols) {
+      return writer.local_symbols->imports.get_or_add(impr, writer.tell());
     }
+    return get_or_add_impr(impr);
   }
 
-  uint32_t get_or_add_expr(std::string expr, uint32_t object_idx) {
-    std::vector<uint32_t> vec;
-    for (auto str : std::views::split(expr, '/')) {
-      std::string foo = std::string(str.begin(), str.end());
-      vec.push_back(get_or_add_tran(foo));
+  uint32_t get_or_add_tran(std::string_view str) {
+    return gen_trans.get_or_add(str);
+  }
+
+  uint32_t get_or_add_impr(std::string_view impr) {
+    auto get_tran = [this](std::string_view str) {
+      return get_or_add_tran(str);
+    };
+    auto &node = gen_import_paths.get_node(
+        gen_import_paths.get_or_add_path(impr, get_tran));
+    if (node.index == NDFPathTrie::no_index) {
+      node.index = gen_import_count++;
     }
-    return get_or_add_expr_indices(vec, object_idx);
+    return node.index;
+  }
+
+  void add_expr(const std::string &expr, uint32_t object_idx) {
+    auto get_tran = [this](std::string_view str) {
+      return get_or_add_tran(str);
+    };
+    gen_export_paths.get_node(gen_export_paths.get_or_add_path(expr, get_tran))
+        .index = object_idx;
   }
   friend struct NDFProperty;
   friend struct NDFPropertyBool;
@@ -256,10 +675,58 @@ private:
   friend struct NDFPropertyPair;
 
 public:
-  void load_from_ndfbin_stream(std::istream &stream);
-  void load_from_ndfbin(fs::path path);
-  void save_as_ndfbin_stream(std::ostream &stream);
-  void save_as_ndfbin(fs::path);
+  // decodes the ndfbin in the given buffer, the buffer is kept alive as long
+  // as the string tables reference it. compressed files are inflated into a
+  // new buffer first.
+  // replaces everything in this NDF with the objects of the file.
+  // with lazy set only the object table is indexed, the properties of an
+  // object are decoded on first access via get_object or objects()
+  // with deduplicate set identical lists, maps and pairs are shared while
+  // decoding, like deduplicate_properties() (not for lazy loads)
+  void load_from_ndfbin_buffer(std::unique_ptr<NDFBinBuffer> buffer,
+                               bool lazy = false, bool deduplicate = false);
+  void load_from_ndfbin_stream(std::istream &stream, bool lazy = false,
+                               bool deduplicate = false);
+  // memory maps the file
+  void load_from_ndfbin(fs::path path, bool lazy = false,
+                        bool deduplicate = false);
+  // walks all objects and properties of the ndfbin without building an
+  // object tree, only the string/class/import tables are kept in memory
+  static void visit_ndfbin(fs::path path, NDFBinVisitor &visitor);
+  static void visit_ndfbin_stream(std::istream &stream, NDFBinVisitor &visitor);
+  // reads only the header/TOC and the requested sections of a ndfbin file,
+  // compressed files have to be inflated as a whole
+  static NDFBinSummary probe_ndfbin(fs::path path,
+                                    NDFBinProbeOptions options = {});
+  // probes all .ndfbin files below directory on multiple threads, sorted by
+  // path. errors are reported per file in NDFBinSummary::error
+  static std::vector<NDFBinSummary>
+  probe_ndfbin_directory(fs::path directory, NDFBinProbeOptions options = {});
+  // with incremental set, objects loaded from ndfbin that weren't modified
+  // are copied from the loaded file instead of being encoded again. falls
+  // back to a full save if the tables of the loaded file can't be reused.
+  // an object counts as modified if NDFObject::modifications changed (every
+  // change of its properties does that) or its class changed.
+  // the file is built in memory and written front to back in one go, so the
+  // stream doesn't need to be seekable (pipes, compressors, sockets).
+  // with compressed set, the body is written as a zlib stream deflated on
+  // multiple threads, like the compressed files of the game.
+  void save_as_ndfbin_stream(std::ostream &stream, bool incremental = false,
+                             bool compressed = false);
+  // writes a temporary file next to path and renames it, so a file loaded
+  // with load_from_ndfbin stays mapped. windows can't replace mapped files,
+  // saving over the mapped file throws there.
+  void save_as_ndfbin(fs::path, bool incremental = false,
+                      bool compressed = false);
+
+  // allocation statistics of every arena, see NDFArena
+  std::vector<NDFArenaStats> get_arena_stats() const {
+    std::vector<NDFArenaStats> ret;
+    for (const auto &arena : arenas) {
+      ret.push_back(arena->stats());
+    }
+    return ret;
+  }
 
   void clear() {
     import_name_table.clear();
@@ -268,18 +735,12 @@ public:
     property_table.clear();
     tran_table.clear();
     object_map.clear();
-    gen_object_items.clear();
-    gen_string_items.clear();
-    gen_string_table.clear();
-    gen_clas_items.clear();
-    gen_clas_table.clear();
-    gen_tran_items.clear();
-    gen_tran_table.clear();
-    gen_import_table.clear();
-    gen_import_items.clear();
-    gen_export_table.clear();
-    gen_export_items.clear();
-    gen_property_table.clear();
+    clear_gen_tables();
+    schema.clear();
+    dedup_stats.clear();
+    ndfbin_buffer.reset();
+    // after object_map, the properties are allocated from the arenas
+    arenas.clear();
   }
   // db accessors
 public:
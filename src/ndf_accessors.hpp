@@ -0,0 +1,487 @@
+#pragma once
+
+#include "ndf_name.hpp"
+#include "ndf_properties.hpp"
+#include "ndf_value.hpp"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+// typed access to property values without as_string() or casting by hand.
+// NDFValueTraits<T> maps a C++ type to its NDFPropertyType and property
+// struct at compile time, the type is checked against property_type, so
+// there are no RTTI or virtual calls, except for telling object and import
+// references apart (both are 0x9).
+// the value types are the alternatives of NDFValue, with std::string_view
+// for String. string views point into the property or the tables of the
+// NDF, like NDFValue.
+
+template <typename T, uint32_t Type, typename P> struct NDFValueTraitsBase {
+  using Property = P;
+  static constexpr uint32_t type = Type;
+  static bool matches(const NDFProperty &property) {
+    return property.property_type == Type;
+  }
+  static std::optional<T> from_value(const NDFValue &value) {
+    if (auto *v = std::get_if<T>(&value)) {
+      return *v;
+    }
+    return std::nullopt;
+  }
+};
+
+template <typename T> struct NDFValueTraits {};
+
+template <typename T, uint32_t Type, typename P>
+struct NDFScalarTraits : NDFValueTraitsBase<T, Type, P> {
+  static T from_property(const P &property) { return property.value; }
+};
+
+template <>
+struct NDFValueTraits<bool>
+    : NDFScalarTraits<bool, NDFPropertyType::Bool, NDFPropertyBool> {};
+template <>
+struct NDFValueTraits<uint8_t>
+    : NDFScalarTraits<uint8_t, NDFPropertyType::UInt8, NDFPropertyUInt8> {};
+template <>
+struct NDFValueTraits<int16_t>
+    : NDFScalarTraits<int16_t, NDFPropertyType::Int16, NDFPropertyInt16> {};
+template <>
+struct NDFValueTraits<uint16_t>
+    : NDFScalarTraits<uint16_t, NDFPropertyType::UInt16, NDFPropertyUInt16> {
+};
+template <>
+struct NDFValueTraits<double>
+    : NDFScalarTraits<double, NDFPropertyType::Float64, NDFPropertyFloat64> {};
+
+// the types packed lists keep as raw 32 bit words, see NDFPropertyList::packed
+template <>
+struct NDFValueTraits<int32_t>
+    : NDFScalarTraits<int32_t, NDFPropertyType::Int32, NDFPropertyInt32> {
+  static constexpr size_t words = 1;
+  static int32_t from_words(const uint32_t *item) {
+    return std::bit_cast<int32_t>(item[0]);
+  }
+};
+template <>
+struct NDFValueTraits<uint32_t>
+    : NDFScalarTraits<uint32_t, NDFPropertyType::UInt32, NDFPropertyUInt32> {
+  static constexpr size_t words = 1;
+  static uint32_t from_words(const uint32_t *item) { return item[0]; }
+};
+template <>
+struct NDFValueTraits<float>
+    : NDFScalarTraits<float, NDFPropertyType::Float32, NDFPropertyFloat32> {
+  static constexpr size_t words = 1;
+  static float from_words(const uint32_t *item) {
+    return std::bit_cast<float>(item[0]);
+  }
+};
+template <>
+struct NDFValueTraits<std::array<float, 3>>
+    : NDFValueTraitsBase<std::array<float, 3>, NDFPropertyType::F32_vec3,
+                         NDFPropertyF32_vec3> {
+  static constexpr size_t words = 3;
+  static std::array<float, 3> from_words(const uint32_t *item) {
+    return {std::bit_cast<float>(item[0]), std::bit_cast<float>(item[1]),
+            std::bit_cast<float>(item[2])};
+  }
+  static std::array<float, 3> from_property(const NDFPropertyF32_vec3 &p) {
+    return {p.x, p.y, p.z};
+  }
+};
+
+template <>
+struct NDFValueTraits<std::string_view>
+    : NDFValueTraitsBase<std::string_view, NDFPropertyType::String,
+                         NDFPropertyString> {
+  static std::string_view from_property(const NDFPropertyString &property) {
+    return property.value;
+  }
+  static std::optional<std::string_view> from_value(const NDFValue &value) {
+    if (auto *v = std::get_if<NDFStringValue>(&value)) {
+      return v->value;
+    }
+    return std::nullopt;
+  }
+};
+template <>
+struct NDFValueTraits<NDFPathValue>
+    : NDFValueTraitsBase<NDFPathValue, NDFPropertyType::PathReference,
+                         NDFPropertyPathReference> {
+  static NDFPathValue from_property(const NDFPropertyPathReference &property) {
+    return {property.path};
+  }
+};
+// references created by name have no index, see
+// NDFPropertyObjectReference::no_object
+template <>
+struct NDFValueTraits<NDFObjectValue>
+    : NDFValueTraitsBase<NDFObjectValue, NDFPropertyType::ObjectReference,
+                         NDFPropertyObjectReference> {
+  static bool matches(const NDFProperty &property) {
+    return property.property_type == type && property.is_object_reference();
+  }
+  static NDFObjectValue
+  from_property(const NDFPropertyObjectReference &property) {
+    return {property.object_index};
+  }
+};
+template <>
+struct NDFValueTraits<NDFImportValue>
+    : NDFValueTraitsBase<NDFImportValue, NDFPropertyType::ImportReference,
+                         NDFPropertyImportReference> {
+  static bool matches(const NDFProperty &property) {
+    return property.property_type == type && property.is_import_reference();
+  }
+  static NDFImportValue
+  from_property(const NDFPropertyImportReference &property) {
+    return {property.import_name};
+  }
+};
+
+template <>
+struct NDFValueTraits<std::array<float, 2>>
+    : NDFValueTraitsBase<std::array<float, 2>, NDFPropertyType::F32_vec2,
+                         NDFPropertyF32_vec2> {
+  static std::array<float, 2> from_property(const NDFPropertyF32_vec2 &p) {
+    return {p.x, p.y};
+  }
+};
+template <>
+struct NDFValueTraits<std::array<float, 4>>
+    : NDFValueTraitsBase<std::array<float, 4>, NDFPropertyType::F32_vec4,
+                         NDFPropertyF32_vec4> {
+  static std::array<float, 4> from_property(const NDFPropertyF32_vec4 &p) {
+    return {p.x, p.y, p.z, p.w};
+  }
+};
+template <>
+struct NDFValueTraits<std::array<int32_t, 2>>
+    : NDFValueTraitsBase<std::array<int32_t, 2>, NDFPropertyType::S32_vec2,
+                         NDFPropertyS32_vec2> {
+  static std::array<int32_t, 2> from_property(const NDFPropertyS32_vec2 &p) {
+    return {p.x, p.y};
+  }
+};
+template <>
+struct NDFValueTraits<std::array<int32_t, 3>>
+    : NDFValueTraitsBase<std::array<int32_t, 3>, NDFPropertyType::S32_vec3,
+                         NDFPropertyS32_vec3> {
+  static std::array<int32_t, 3> from_property(const NDFPropertyS32_vec3 &p) {
+    return {p.x, p.y, p.z};
+  }
+};
+template <>
+struct NDFValueTraits<NDFColorValue>
+    : NDFValueTraitsBase<NDFColorValue, NDFPropertyType::Color,
+                         NDFPropertyColor> {
+  static NDFColorValue from_property(const NDFPropertyColor &p) {
+    return {p.b, p.g, p.r, p.a};
+  }
+};
+template <>
+struct NDFValueTraits<NDFGUIDValue>
+    : NDFValueTraitsBase<NDFGUIDValue, NDFPropertyType::NDFGUID,
+                         NDFPropertyGUID> {
+  static NDFGUIDValue from_property(const NDFPropertyGUID &p) {
+    return {p.guid};
+  }
+};
+template <>
+struct NDFValueTraits<NDFLocalisationHashValue>
+    : NDFValueTraitsBase<NDFLocalisationHashValue,
+                         NDFPropertyType::LocalisationHash,
+                         NDFPropertyLocalisationHash> {
+  static NDFLocalisationHashValue
+  from_property(const NDFPropertyLocalisationHash &p) {
+    return {p.hash};
+  }
+};
+template <>
+struct NDFValueTraits<NDFHashValue>
+    : NDFValueTraitsBase<NDFHashValue, NDFPropertyType::Hash,
+                         NDFPropertyHash> {
+  static NDFHashValue from_property(const NDFPropertyHash &p) {
+    return {p.hash};
+  }
+};
+
+template <typename T>
+concept NDFAccessible = requires { NDFValueTraits<T>::type; };
+// can be read directly from the words of a packed list
+template <typename T>
+concept NDFPackable =
+    NDFAccessible<T> && requires { NDFValueTraits<T>::words; };
+
+inline std::runtime_error ndf_type_error(std::string_view name, uint32_t type,
+                                         uint32_t expected) {
+  return std::runtime_error(std::format(
+      "Property {} has type 0x{:X}, not 0x{:X}", name, type, expected));
+}
+
+// the value of property, std::nullopt if it has a different type
+template <NDFAccessible T>
+std::optional<T> ndf_try_get(const NDFProperty &property) {
+  using Traits = NDFValueTraits<T>;
+  if (!Traits::matches(property)) {
+    return std::nullopt;
+  }
+  return Traits::from_property(
+      static_cast<const typename Traits::Property &>(property));
+}
+
+// the value of property, throws std::runtime_error if it has a different type
+template <NDFAccessible T> T ndf_get(const NDFProperty &property) {
+  if (auto ret = ndf_try_get<T>(property)) {
+    return *ret;
+  }
+  throw ndf_type_error(property.property_name, property.property_type,
+                       NDFValueTraits<T>::type);
+}
+
+// calls f with the property cast to its property struct, switching on
+// property_type instead of calling a virtual function
+template <typename F> decltype(auto) ndf_visit(const NDFProperty &p, F &&f) {
+  switch (p.property_type) {
+  case NDFPropertyType::Bool:
+    return f(static_cast<const NDFPropertyBool &>(p));
+  case NDFPropertyType::UInt8:
+    return f(static_cast<const NDFPropertyUInt8 &>(p));
+  case NDFPropertyType::Int16:
+    return f(static_cast<const NDFPropertyInt16 &>(p));
+  case NDFPropertyType::UInt16:
+    return f(static_cast<const NDFPropertyUInt16 &>(p));
+  case NDFPropertyType::Int32:
+    return f(static_cast<const NDFPropertyInt32 &>(p));
+  case NDFPropertyType::UInt32:
+    return f(static_cast<const NDFPropertyUInt32 &>(p));
+  case NDFPropertyType::Float32:
+    return f(static_cast<const NDFPropertyFloat32 &>(p));
+  case NDFPropertyType::Float64:
+    return f(static_cast<const NDFPropertyFloat64 &>(p));
+  case NDFPropertyType::String:
+    return f(static_cast<const NDFPropertyString &>(p));
+  case NDFPropertyType::WideString:
+    return f(static_cast<const NDFPropertyWideString &>(p));
+  case NDFPropertyType::ObjectReference:
+    // also ImportReference
+    if (p.is_object_reference()) {
+      return f(static_cast<const NDFPropertyObjectReference &>(p));
+    }
+    return f(static_cast<const NDFPropertyImportReference &>(p));
+  case NDFPropertyType::F32_vec2:
+    return f(static_cast<const NDFPropertyF32_vec2 &>(p));
+  case NDFPropertyType::F32_vec3:
+    return f(static_cast<const NDFPropertyF32_vec3 &>(p));
+  case NDFPropertyType::F32_vec4:
+    return f(static_cast<const NDFPropertyF32_vec4 &>(p));
+  case NDFPropertyType::S32_vec2:
+    return f(static_cast<const NDFPropertyS32_vec2 &>(p));
+  case NDFPropertyType::S32_vec3:
+    return f(static_cast<const NDFPropertyS32_vec3 &>(p));
+  case NDFPropertyType::Color:
+    return f(static_cast<const NDFPropertyColor &>(p));
+  case NDFPropertyType::NDFGUID:
+    return f(static_cast<const NDFPropertyGUID &>(p));
+  case NDFPropertyType::PathReference:
+    return f(static_cast<const NDFPropertyPathReference &>(p));
+  case NDFPropertyType::LocalisationHash:
+    return f(static_cast<const NDFPropertyLocalisationHash &>(p));
+  case NDFPropertyType::Hash:
+    return f(static_cast<const NDFPropertyHash &>(p));
+  case NDFPropertyType::List:
+    return f(static_cast<const NDFPropertyList &>(p));
+  case NDFPropertyType::Map:
+    return f(static_cast<const NDFPropertyMap &>(p));
+  case NDFPropertyType::Pair:
+    return f(static_cast<const NDFPropertyPair &>(p));
+  default:
+    throw std::runtime_error(
+        std::format("Unknown NDFType 0x{:X} of property {}", p.property_type,
+                    p.property_name.str()));
+  }
+}
+
+// a property or an item of a list, map or pair, which is either a property
+// or kept packed as a value
+struct NDFItem {
+  const NDFProperty *property = nullptr;
+  // only set if property is nullptr
+  NDFValue value;
+
+  NDFItem(const NDFProperty &property) : property(&property) {}
+  NDFItem(const NDFValue &value) : value(value) {}
+
+  uint32_t get_type() const {
+    return property ? property->property_type : get_ndf_value_type(value);
+  }
+
+  template <NDFAccessible T> std::optional<T> try_get() const {
+    if (property) {
+      return ndf_try_get<T>(*property);
+    }
+    return NDFValueTraits<T>::from_value(value);
+  }
+  template <NDFAccessible T> T get() const {
+    if (auto ret = try_get<T>()) {
+      return *ret;
+    }
+    throw ndf_type_error(property ? property->property_name.str() : "item",
+                         get_type(), NDFValueTraits<T>::type);
+  }
+};
+
+// item i of a list, packed or not
+NDFItem ndf_list_item(const NDFPropertyList &list, size_t i);
+
+// the items of a list as T, read directly from whatever representation the
+// list has (packed words, packed values or properties) without unpacking or
+// allocating. throws std::runtime_error for items of another type. the view
+// must not outlive the list and changing the list invalidates it.
+template <NDFAccessible T> class NDFListView {
+private:
+  const NDFPropertyList *m_list;
+
+public:
+  explicit NDFListView(const NDFPropertyList &list) : m_list(&list) {
+    if (!list.packed.empty() && list.packed_type != NDFValueTraits<T>::type) {
+      throw ndf_type_error(list.property_name, list.packed_type,
+                           NDFValueTraits<T>::type);
+    }
+  }
+
+  size_t size() const { return m_list->size(); }
+  bool empty() const { return size() == 0; }
+
+  T operator[](size_t i) const {
+    if constexpr (NDFPackable<T>) {
+      if (!m_list->packed.empty()) {
+        return NDFValueTraits<T>::from_words(m_list->packed.data() +
+                                             i * NDFValueTraits<T>::words);
+      }
+    }
+    if (!m_list->packed_values.empty()) {
+      return NDFItem(m_list->packed_values[i]).get<T>();
+    }
+    return ndf_get<T>(*m_list->values()[i]);
+  }
+
+  class iterator {
+  private:
+    const NDFListView *m_view = nullptr;
+    size_t m_index = 0;
+
+  public:
+    using iterator_concept = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+    iterator(const NDFListView *view, size_t index)
+        : m_view(view), m_index(index) {}
+    T operator*() const { return (*m_view)[m_index]; }
+    iterator &operator++() {
+      m_index++;
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator ret = *this;
+      m_index++;
+      return ret;
+    }
+    bool operator==(const iterator &other) const {
+      return m_index == other.m_index;
+    }
+  };
+  iterator begin() const { return {this, 0}; }
+  iterator end() const { return {this, size()}; }
+};
+
+// lists are checked against T, everything else throws
+template <NDFAccessible T>
+NDFListView<T> ndf_get_list(const NDFProperty &property) {
+  if (property.property_type != NDFPropertyType::List) {
+    throw ndf_type_error(property.property_name, property.property_type,
+                         NDFPropertyType::List);
+  }
+  return NDFListView<T>(static_cast<const NDFPropertyList &>(property));
+}
+
+struct NDF;
+struct NDFObject;
+struct NDFPropertyLayout;
+
+// precompiled path to a property, e.g. "Modules/WeaponManager/Salves[2]".
+// segments are separated by '/', every segment names a property and may be
+// followed by indices:
+// - [n] selects item n of a list, or first/second of a pair for 0/1
+// - [key] selects the value of the map entry with a string key equal to key,
+//   or a numeric key equal to key
+// a segment after an object reference continues in the referenced object,
+// import references can't be followed.
+// names are interned when the path is compiled and every property segment
+// caches the slot it found for the last NDFPropertyLayout, so resolving the
+// path for thousands of objects of one class only compares layout pointers.
+// the cache makes resolve not thread safe, use one path per thread.
+class NDFPropertyPath {
+private:
+  struct Step {
+    // property of the current object if set, an index otherwise
+    std::optional<NDFName> name = std::nullopt;
+    std::string key = {};
+    std::optional<uint64_t> index = std::nullopt;
+    // keeps the layout alive, so its address isn't reused by another one
+    mutable std::shared_ptr<const NDFPropertyLayout> layout = nullptr;
+    mutable uint32_t slot = 0;
+  };
+  std::string m_path;
+  std::vector<Step> m_steps;
+
+  const NDFProperty *find_property(const Step &step, NDFObject &object) const;
+
+public:
+  // throws std::runtime_error for malformed paths
+  explicit NDFPropertyPath(std::string_view path);
+
+  const std::string &str() const { return m_path; }
+
+  // the property or item the path points to, std::nullopt if it doesn't
+  // exist in object. lazily loaded objects are decoded when the path reaches
+  // them. the item is valid as long as the properties on the path don't change.
+  std::optional<NDFItem> resolve(NDF &ndf, NDFObject &object) const;
+
+  // std::nullopt if the path doesn't exist, throws std::runtime_error if
+  // it has a different type
+  template <NDFAccessible T>
+  std::optional<T> get(NDF &ndf, NDFObject &object) const {
+    auto item = resolve(ndf, object);
+    if (!item) {
+      return std::nullopt;
+    }
+    return item->get<T>();
+  }
+  template <NDFAccessible T>
+  std::optional<NDFListView<T>> get_list(NDF &ndf, NDFObject &object) const {
+    auto item = resolve(ndf, object);
+    if (!item) {
+      return std::nullopt;
+    }
+    if (!item->property) {
+      throw ndf_type_error(m_path, item->get_type(), NDFPropertyType::List);
+    }
+    return ndf_get_list<T>(*item->property);
+  }
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+struct NDFArenaStats {
+  // bytes handed out
+  size_t allocated_bytes = 0;
+  // bytes requested from the heap, the arena grows in fixed size chunks
+  size_t reserved_bytes = 0;
+  size_t allocations = 0;
+};
+
+// monotonic memory of a NDF, deallocating is a no-op and everything is
+// released at once when the arena is destroyed (NDF::clear() or the
+// destructor of the NDF).
+// NDFProperty and the packed storage of lists/maps are allocated from the
+// arena of the current thread while a Scope is alive, see
+// NDFProperty::operator new. these must not outlive the NDF, NDF::add_object
+// copies the properties of objects moved from another NDF.
+// an arena is only used by one thread at a time, parallel decoding uses one
+// arena per thread.
+class NDFArena : public std::pmr::memory_resource {
+private:
+  // fixed size chunks, unlike std::pmr::monotonic_buffer_resource which
+  // doubles them and leaves up to half of the last chunk unused
+  size_t m_chunk_size;
+  std::vector<std::unique_ptr<char[]>> m_chunks;
+  char *m_cursor = nullptr;
+  size_t m_left = 0;
+  NDFArenaStats m_stats;
+
+  static inline thread_local NDFArena *m_current = nullptr;
+
+  char *add_chunk(size_t size) {
+    m_chunks.push_back(std::make_unique_for_overwrite<char[]>(size));
+    m_stats.reserved_bytes += size;
+    return m_chunks.back().get();
+  }
+
+  void *do_allocate(size_t bytes, size_t alignment) override {
+    m_stats.allocated_bytes += bytes;
+    m_stats.allocations++;
+    void *ptr = m_cursor;
+    if (!std::align(alignment, bytes, ptr, m_left)) {
+      // large allocations get their own chunk and keep the current one
+      if (bytes + alignment > m_chunk_size / 4) {
+        ptr = add_chunk(bytes + alignment);
+        size_t size = bytes + alignment;
+        return std::align(alignment, bytes, ptr, size);
+      }
+      m_cursor = add_chunk(m_chunk_size);
+      m_left = m_chunk_size;
+      ptr = m_cursor;
+      std::align(alignment, bytes, ptr, m_left);
+    }
+    m_cursor = static_cast<char *>(ptr) + bytes;
+    m_left -= bytes;
+    return ptr;
+  }
+  void do_deallocate(void *, size_t, size_t) override {}
+  bool do_is_equal(const memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+public:
+  explicit NDFArena(size_t chunk_size = 64 * 1024)
+      : m_chunk_size(chunk_size) {}
+  NDFArena(const NDFArena &) = delete;
+  NDFArena &operator=(const NDFArena &) = delete;
+
+  NDFArenaStats stats() const { return m_stats; }
+
+  // state of the arena, rewinding to it frees everything allocated since
+  struct Mark {
+    size_t chunks;
+    char *cursor;
+    size_t left;
+    NDFArenaStats stats;
+  };
+  Mark mark() const { return {m_chunks.size(), m_cursor, m_left, m_stats}; }
+  // nothing allocated after mark may still be in use
+  void rewind(const Mark &mark) {
+    m_chunks.resize(mark.chunks);
+    m_cursor = mark.cursor;
+    m_left = mark.left;
+    m_stats = mark.stats;
+  }
+  // arena of this thread, nullptr outside of a Scope
+  static NDFArena *current() { return m_current; }
+  // current arena or the heap
+  static std::pmr::memory_resource *current_resource() {
+    if (m_current) {
+      return m_current;
+    }
+    return std::pmr::new_delete_resource();
+  }
+
+  // makes arena the current arena of this thread until destroyed
+  class Scope {
+  private:
+    NDFArena *m_previous;
+
+  public:
+    explicit Scope(NDFArena *arena) : m_previous(m_current) {
+      m_current = arena;
+    }
+    ~Scope() { m_current = m_previous; }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+  };
+};
@@ -1,23 +1,12 @@
 #include "ndf.hpp"
+#include "ndfbin_reader.hpp"
+#include "ndfbin_writer.hpp"
 #include "utf.hpp"
 
-std::unique_ptr<NDFProperty>
-NDFProperty::get_property_from_ndfbin(uint32_t ndf_type, std::istream &stream) {
-  spdlog::debug("NDFType: {} @0x{:02X}", ndf_type, (uint32_t)stream.tellg());
-  if (ndf_type == 0x9) {
-    uint32_t reference_type;
-    stream.read(reinterpret_cast<char *>(&reference_type), sizeof(uint32_t));
-    if (reference_type == ReferenceType::Object) {
-      return std::make_unique<NDFPropertyObjectReference>();
-    } else if (reference_type == ReferenceType::Import) {
-      return std::make_unique<NDFPropertyImportReference>();
-    } else {
-      throw std::runtime_error(
-          std::format("Unknown ReferenceType: {}", reference_type));
-    }
-  }
-  return get_property_from_ndftype(ndf_type);
-}
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
 
 #pragma pack(push, 1)
 struct NDF_Bool {
@@ -25,15 +14,14 @@ struct NDF_Bool {
 };
 #pragma pack(pop)
 
-void NDFPropertyBool::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_Bool ndf_bool;
-  stream.read(reinterpret_cast<char *>(&ndf_bool), sizeof(NDF_Bool));
+void NDFPropertyBool::from_ndfbin(NDF *, NDFBinReader &reader) {
+  NDF_Bool ndf_bool = reader.read<NDF_Bool>();
   value = ndf_bool.value;
 }
-void NDFPropertyBool::to_ndfbin(NDF *, std::ostream &stream) const {
+void NDFPropertyBool::to_ndfbin(NDF *, NDFBinWriter &writer) const {
   NDF_Bool ndf_bool;
   ndf_bool.value = value;
-  stream.write(reinterpret_cast<char *>(&ndf_bool), sizeof(NDF_Bool));
+  writer.write(ndf_bool);
 }
 
 #pragma pack(push, 1)
@@ -42,15 +30,14 @@ struct NDF_UInt8 {
 };
 #pragma pack(pop)
 
-void NDFPropertyUInt8::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_UInt8 ndf_int8;
-  stream.read(reinterpret_cast<char *>(&ndf_int8), sizeof(NDF_UInt8));
+void NDFPropertyUInt8::from_ndfbin(NDF *, NDFBinReader &reader) {
+  NDF_UInt8 ndf_int8 = reader.read<NDF_UInt8>();
   value = ndf_int8.value;
 }
-void NDFPropertyUInt8::to_ndfbin(NDF *, std::ostream &stream) const {
+void NDFPropertyUInt8::to_ndfbin(NDF *, NDFBinWriter &writer) const {
   NDF_UInt8 ndf_int8;
   ndf_int8.value = value;
-  stream.write(reinterpret_cast<char *>(&ndf_int8), sizeof(NDF_UInt8));
+  writer.write(ndf_int8);
 }
 
 #pragma pack(push, 1)
@@ -59,15 +46,14 @@ struct NDF_Int32 {
 };
 #pragma pack(pop)
 
-void NDFPropertyInt32::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_Int32 ndf_int32;
-  stream.read(reinterpret_cast<char *>(&ndf_int32), sizeof(NDF_Int32));
+void NDFPropertyInt32::from_ndfbin(NDF *, NDFBinReader &reader) {
+  NDF_Int32 ndf_int32 = reader.read<NDF_Int32>();
   value = ndf_int32.value;
 }
-void NDFPropertyInt32::to_ndfbin(NDF *, std::ostream &stream) const {
+void NDFPropertyInt32::to_ndfbin(NDF *, NDFBinWriter &writer) const {
   NDF_Int32 ndf_int32;
   ndf_int32.value = value;
-  stream.write(reinterpret_cast<char *>(&ndf_int32), sizeof(NDF_Int32));
+  writer.write(ndf_int32);
 }
 
 #pragma pack(push, 1)
@@ -76,15 +62,14 @@ struct NDF_UInt32 {
 };
 #pragma pack(pop)
 
-void NDFPropertyUInt32::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_UInt32 ndf_uint32;
-  stream.read(reinterpret_cast<char *>(&ndf_uint32), sizeof(NDF_UInt32));
+void NDFPropertyUInt32::from_ndfbin(NDF *, NDFBinReader &reader) {
+  NDF_UInt32 ndf_uint32 = reader.read<NDF_UInt32>();
   value = ndf_uint32.value;
 }
-void NDFPropertyUInt32::to_ndfbin(NDF *, std::ostream &stream) const {
+void NDFPropertyUInt32::to_ndfbin(NDF *, NDFBinWriter &writer) const {
   NDF_UInt32 ndf_uint32;
   ndf_uint32.value = value;
-  stream.write(reinterpret_cast<char *>(&ndf_uint32), sizeof(NDF_UInt32));
+  writer.write(ndf_uint32);
 }
 
 #pragma pack(push, 1)
@@ -93,15 +78,14 @@ struct NDF_Float32 {
 };
 #pragma pack(pop)
 
-void NDFPropertyFloat32::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_Float32 ndf_float32;
-  stream.read(reinterpret_cast<char *>(&ndf_float32), sizeof(NDF_Float32));
+void NDFPropertyFloat32::from_ndfbin(NDF *, NDFBinReader &reader) {
+  NDF_Float32 ndf_float32 = reader.read<NDF_Float32>();
   value = ndf_float32.value;
 }
-void NDFPropertyFloat32::to_ndfbin(NDF *, std::ostream &stream) const {
+void NDFPropertyFloat32::to_ndfbin(NDF *, NDFBinWriter &writer) const {
   NDF_Float32 ndf_float32;
   ndf_float32.value = value;
-  stream.write(reinterpret_cast<char *>(&ndf_float32), sizeof(NDF_Float32));
+  writer.write(ndf_float32);
 }
 
 #pragma pack(push, 1)
@@ -110,15 +94,14 @@ struct NDF_Float64 {
 };
 #pragma pack(pop)
 
-void NDFPropertyFloat64::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_Float64 ndf_float64;
-  stream.read(reinterpret_cast<char *>(&ndf_float64), sizeof(NDF_Float64));
+void NDFPropertyFloat64::from_ndfbin(NDF *, NDFBinReader &reader) {
+  NDF_Float64 ndf_float64 = reader.read<NDF_Float64>();
   value = ndf_float64.value;
 }
-void NDFPropertyFloat64::to_ndfbin(NDF *, std::ostream &stream) const {
+void NDFPropertyFloat64::to_ndfbin(NDF *, NDFBinWriter &writer) const {
   NDF_Float64 ndf_float64;
   ndf_float64.value = value;
-  stream.write(reinterpret_cast<char *>(&ndf_float64), sizeof(NDF_Float64));
+  writer.write(ndf_float64);
 }
 
 #pragma pack(push, 1)
@@ -127,16 +110,15 @@ struct NDF_String {
 };
 #pragma pack(pop)
 
-void NDFPropertyString::from_ndfbin(NDF *root, std::istream &stream) {
-  NDF_String ndf_string;
-  stream.read(reinterpret_cast<char *>(&ndf_string), sizeof(NDF_String));
-  value = root->string_table[ndf_string.string_index];
+void NDFPropertyString::from_ndfbin(NDF *root, NDFBinReader &reader) {
+  NDF_String ndf_string = reader.read<NDF_String>();
+  value = root->string_table.at(ndf_string.string_index);
 }
 
-void NDFPropertyString::to_ndfbin(NDF *root, std::ostream &stream) const {
+void NDFPropertyString::to_ndfbin(NDF *root, NDFBinWriter &writer) const {
   NDF_String ndf_string;
-  ndf_string.string_index = root->get_or_add_string(value);
-  stream.write(reinterpret_cast<char *>(&ndf_string), sizeof(NDF_String));
+  ndf_string.string_index = root->get_string_index(writer, value);
+  writer.write(ndf_string);
 }
 
 #pragma pack(push, 1)
@@ -145,30 +127,29 @@ struct NDF_WideString {
 };
 #pragma pack(pop)
 
-void NDFPropertyWideString::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_WideString ndf_wide_string;
-  stream.read(reinterpret_cast<char *>(&ndf_wide_string),
-              sizeof(NDF_WideString));
-  assert(ndf_wide_string.length % 2 == 0);
-  std::u16string str;
-  for (uint32_t i = 0; i < ndf_wide_string.length / 2; i++) {
-    char16_t c;
-    stream.read(reinterpret_cast<char *>(&c), sizeof(char16_t));
-    str.push_back(c);
+void NDFPropertyWideString::from_ndfbin(NDF *, NDFBinReader &reader) {
+  NDF_WideString ndf_wide_string = reader.read<NDF_WideString>();
+  if (ndf_wide_string.length % 2 != 0) {
+    throw std::runtime_error(
+        std::format("Invalid WideString length {} @0x{:02X}",
+                    ndf_wide_string.length, reader.tell()));
   }
+  reader.require(ndf_wide_string.length);
+  std::u16string str;
+  str.resize(ndf_wide_string.length / 2);
+  reader.read_into(str.data(), str.size());
   // convert to UTF-8
   value = Utf32To8(Utf16To32(str));
   spdlog::debug("WideString: {}", value);
 }
 
-void NDFPropertyWideString::to_ndfbin(NDF *, std::ostream &stream) const {
+void NDFPropertyWideString::to_ndfbin(NDF *, NDFBinWriter &writer) const {
   NDF_WideString ndf_wide_string;
   ndf_wide_string.length = value.size() * 2;
-  stream.write(reinterpret_cast<char *>(&ndf_wide_string),
-               sizeof(NDF_WideString));
+  writer.write(ndf_wide_string);
   // convert to UTF-16
   std::u16string buffer = Utf32To16(Utf8To32(value));
-  stream.write((char *)buffer.data(), buffer.size() * sizeof(char16_t));
+  writer.write_bytes(buffer.data(), buffer.size() * sizeof(char16_t));
 }
 
 #pragma pack(push, 1)
@@ -179,19 +160,18 @@ struct NDF_F32_vec3 {
 };
 #pragma pack(pop)
 
-void NDFPropertyF32_vec3::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_F32_vec3 ndf_f32_vec3;
-  stream.read(reinterpret_cast<char *>(&ndf_f32_vec3), sizeof(NDF_F32_vec3));
+void NDFPropertyF32_vec3::from_ndfbin(NDF *, NDFBinReader &reader) {
+  NDF_F32_vec3 ndf_f32_vec3 = reader.read<NDF_F32_vec3>();
   x = ndf_f32_vec3.x;
   y = ndf_f32_vec3.y;
   z = ndf_f32_vec3.z;
 }
-void NDFPropertyF32_vec3::to_ndfbin(NDF *, std::ostream &stream) const {
+void NDFPropertyF32_vec3::to_ndfbin(NDF *, NDFBinWriter &writer) const {
   NDF_F32_vec3 ndf_f32_vec3;
   ndf_f32_vec3.x = x;
   ndf_f32_vec3.y = y;
   ndf_f32_vec3.z = z;
-  stream.write(reinterpret_cast<char *>(&ndf_f32_vec3), sizeof(NDF_F32_vec3));
+  writer.write(ndf_f32_vec3);
 }
 
 #pragma pack(push, 1)
@@ -203,21 +183,20 @@ struct NDF_F32_vec4 {
 };
 #pragma pack(pop)
 
-void NDFPropertyF32_vec4::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_F32_vec4 ndf_f32_vec4;
-  stream.read(reinterpret_cast<char *>(&ndf_f32_vec4), sizeof(NDF_F32_vec4));
+void NDFPropertyF32_vec4::from_ndfbin(NDF *, NDFBinReader &reader) {
+  NDF_F32_vec4 ndf_f32_vec4 = reader.read<NDF_F32_vec4>();
   x = ndf_f32_vec4.x;
   y = ndf_f32_vec4.y;
   z = ndf_f32_vec4.z;
   w = ndf_f32_vec4.w;
 }
-void NDFPropertyF32_vec4::to_ndfbin(NDF *, std::ostream &stream) const {
+void NDFPropertyF32_vec4::to_ndfbin(NDF *, NDFBinWriter &writer) const {
   NDF_F32_vec4 ndf_f32_vec4;
   ndf_f32_vec4.x = x;
   ndf_f32_vec4.y = y;
   ndf_f32_vec4.z = z;
   ndf_f32_vec4.w = w;
-  stream.write(reinterpret_cast<char *>(&ndf_f32_vec4), sizeof(NDF_F32_vec4));
+  writer.write(ndf_f32_vec4);
 }
 
 #pragma pack(push, 1)
@@ -229,21 +208,20 @@ struct NDF_Color {
 };
 #pragma pack(pop)
 
-void NDFPropertyColor::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_Color ndf_color;
-  stream.read(reinterpret_cast<char *>(&ndf_color), sizeof(NDF_Color));
+void NDFPropertyColor::from_ndfbin(NDF *, NDFBinReader &reader) {
+  NDF_Color ndf_color = reader.read<NDF_Color>();
   r = ndf_color.r;
   g = ndf_color.g;
   b = ndf_color.b;
   a = ndf_color.a;
 }
-void NDFPropertyColor::to_ndfbin(NDF *, std::ostream &stream) const {
+void NDFPropertyColor::to_ndfbin(NDF *, NDFBinWriter &writer) const {
   NDF_Color ndf_color;
   ndf_color.r = r;
   ndf_color.g = g;
   ndf_color.b = b;
   ndf_color.a = a;
-  stream.write(reinterpret_cast<char *>(&ndf_color), sizeof(NDF_Color));
+  writer.write(ndf_color);
 }
 
 #pragma pack(push, 1)
@@ -254,19 +232,18 @@ struct NDF_S32_vec3 {
 };
 #pragma pack(pop)
 
-void NDFPropertyS32_vec3::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_S32_vec3 ndf_s32_vec3;
-  stream.read(reinterpret_cast<char *>(&ndf_s32_vec3), sizeof(NDF_S32_vec3));
+void NDFPropertyS32_vec3::from_ndfbin(NDF *, NDFBinReader &reader) {
+  NDF_S32_vec3 ndf_s32_vec3 = reader.read<NDF_S32_vec3>();
   x = ndf_s32_vec3.x;
   y = ndf_s32_vec3.y;
   z = ndf_s32_vec3.z;
 }
-void NDFPropertyS32_vec3::to_ndfbin(NDF *, std::ostream &stream) const {
+void NDFPropertyS32_vec3::to_ndfbin(NDF *, NDFBinWriter &writer) const {
   NDF_S32_vec3 ndf_s32_vec3;
   ndf_s32_vec3.x = x;
   ndf_s32_vec3.y = y;
   ndf_s32_vec3.z = z;
-  stream.write(reinterpret_cast<char *>(&ndf_s32_vec3), sizeof(NDF_S32_vec3));
+  writer.write(ndf_s32_vec3);
 }
 
 #pragma pack(push, 1)
@@ -276,23 +253,25 @@ struct NDF_ObjectReference {
 };
 #pragma pack(pop)
 
-void NDFPropertyObjectReference::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_ObjectReference ndf_object_reference;
-  stream.read(reinterpret_cast<char *>(&ndf_object_reference),
-              sizeof(NDF_ObjectReference));
-  object_name = "Object_" + std::to_string(ndf_object_reference.object_index);
+void NDFPropertyObjectReference::from_ndfbin(NDF *, NDFBinReader &reader) {
+  NDF_ObjectReference ndf_object_reference = reader.read<NDF_ObjectReference>();
+  object_index = ndf_object_reference.object_index;
+  object_name.clear();
 }
 
 void NDFPropertyObjectReference::to_ndfbin(NDF *root,
-                                           std::ostream &stream) const {
+                                           NDFBinWriter &writer) const {
   uint32_t reference_type = ReferenceType::Object;
-  stream.write(reinterpret_cast<char *>(&reference_type),
-               sizeof(reference_type));
+  writer.write(reference_type);
   NDF_ObjectReference ndf_object_reference;
-  ndf_object_reference.object_index = root->get_object_index(object_name);
-  ndf_object_reference.class_index = root->get_class_of_object(object_name);
-  stream.write(reinterpret_cast<char *>(&ndf_object_reference),
-               sizeof(NDF_ObjectReference));
+  if (object_index != no_object) {
+    ndf_object_reference.object_index = object_index;
+  } else {
+    ndf_object_reference.object_index = root->get_object_index(object_name);
+  }
+  ndf_object_reference.class_index =
+      root->get_class_of_object(ndf_object_reference.object_index);
+  writer.write(ndf_object_reference);
 }
 
 #pragma pack(push, 1)
@@ -301,22 +280,19 @@ struct NDF_ImportReference {
 };
 #pragma pack(pop)
 
-void NDFPropertyImportReference::from_ndfbin(NDF *root, std::istream &stream) {
-  NDF_ImportReference ndf_import_reference;
-  stream.read(reinterpret_cast<char *>(&ndf_import_reference),
-              sizeof(NDF_ImportReference));
-  import_name = root->import_name_table[ndf_import_reference.import_index];
+void NDFPropertyImportReference::from_ndfbin(NDF *root, NDFBinReader &reader) {
+  NDF_ImportReference ndf_import_reference = reader.read<NDF_ImportReference>();
+  import_name = root->import_name_table.at(ndf_import_reference.import_index);
 }
 
 void NDFPropertyImportReference::to_ndfbin(NDF *root,
-                                           std::ostream &stream) const {
+                                           NDFBinWriter &writer) const {
   uint32_t reference_type = ReferenceType::Import;
-  stream.write(reinterpret_cast<char *>(&reference_type),
-               sizeof(reference_type));
+  writer.write(reference_type);
   NDF_ImportReference ndf_import_reference;
-  ndf_import_reference.import_index = root->get_or_add_impr(import_name);
-  stream.write(reinterpret_cast<char *>(&ndf_import_reference),
-               sizeof(NDF_ImportReference));
+  ndf_import_reference.import_index =
+      root->get_import_index(writer, import_name);
+  writer.write(ndf_import_reference);
 }
 
 #pragma pack(push, 1)
@@ -325,64 +301,266 @@ struct NDF_List {
 };
 #pragma pack(pop)
 
-void NDFPropertyList::from_ndfbin(NDF *root, std::istream &stream) {
-  NDF_List ndf_list;
-  stream.read(reinterpret_cast<char *>(&ndf_list), sizeof(NDF_List));
+// number of 32 bit words of an item in a packed list, 0 if the type can't be
+// packed
+static size_t get_packed_item_words(uint32_t ndf_type) {
+  switch (ndf_type) {
+  case NDFPropertyType::Int32:
+  case NDFPropertyType::UInt32:
+  case NDFPropertyType::Float32:
+    return 1;
+  case NDFPropertyType::F32_vec3:
+    return 3;
+  default:
+    return 0;
+  }
+}
+
+// reads the list as packed if all items have the same packable type. the
+// items are stored as (type, payload) with a fixed stride, so checking the
+// types and gathering the payloads are plain strided loops the compiler
+// vectorises.
+static bool read_packed_list(NDFPropertyList &list, uint32_t count,
+                             NDFBinReader &reader) {
+  if (count == 0 || reader.remaining() < sizeof(uint32_t)) {
+    return false;
+  }
+  const char *data = reader.current();
+  uint32_t ndf_type;
+  std::memcpy(&ndf_type, data, sizeof(uint32_t));
+  size_t words = get_packed_item_words(ndf_type);
+  if (words == 0) {
+    return false;
+  }
+  size_t stride = (words + 1) * sizeof(uint32_t);
+  if (count > reader.remaining() / stride) {
+    return false;
+  }
+  uint32_t mismatch = 0;
+  for (size_t i = 0; i < count; i++) {
+    uint32_t item_type;
+    std::memcpy(&item_type, data + i * stride, sizeof(uint32_t));
+    mismatch |= item_type ^ ndf_type;
+  }
+  if (mismatch != 0) {
+    return false;
+  }
+  list.packed.resize(count * words);
+  for (size_t i = 0; i < count; i++) {
+    std::memcpy(list.packed.data() + i * words,
+                data + i * stride + sizeof(uint32_t), words * sizeof(uint32_t));
+  }
+  list.packed_type = ndf_type;
+  reader.skip(count * stride);
+  return true;
+}
+
+void NDFPropertyList::from_ndfbin(NDF *root, NDFBinReader &reader) {
+  NDF_List ndf_list = reader.read<NDF_List>();
+  if (read_packed_list(*this, ndf_list.count, reader)) {
+    return;
+  }
+  // items are kept as packed_values until the first item that isn't fixed
+  // size, then the list falls back to properties
+  NDFValue value;
   for (uint32_t i = 0; i < ndf_list.count; i++) {
-    uint32_t ndf_type = 0xFFFFFFFF;
-    stream.read(reinterpret_cast<char *>(&ndf_type), sizeof(ndf_type));
-    auto property = NDFProperty::get_property_from_ndfbin(ndf_type, stream);
-    property->from_ndfbin(root, stream);
-    property->property_name = "ListItem";
-    values.push_back(std::move(property));
+    uint32_t ndf_type = reader.read<uint32_t>();
+    if (m_values.empty() &&
+        NDFProperty::read_ndfbin_value(ndf_type, root, reader, value)) {
+      // growing would leave the old storage behind in the arena. every item
+      // has at least its type left to read, which bounds broken counts
+      if (packed_values.empty()) {
+        packed_values.reserve(std::min<size_t>(
+            ndf_list.count, reader.remaining() / sizeof(uint32_t) + 1));
+      }
+      packed_values.push_back(value);
+      continue;
+    }
+    unpack();
+    auto property = NDFProperty::read_ndfbin(ndf_type, root, reader);
+    property->property_name = NDFName::list_item;
+    m_values.push_back(std::move(property));
   }
 }
 
-void NDFPropertyList::to_ndfbin(NDF *root, std::ostream &stream) const {
+void NDFPropertyList::to_ndfbin(NDF *root, NDFBinWriter &writer) const {
   NDF_List ndf_list;
-  ndf_list.count = values.size();
-  stream.write(reinterpret_cast<char *>(&ndf_list), sizeof(NDF_List));
-  for (auto &property : values) {
+  ndf_list.count = size();
+  writer.write(ndf_list);
+  if (!packed.empty()) {
+    // interleave the types again directly in the output buffer
+    size_t words = get_packed_item_words(packed_type);
+    size_t item_size = (words + 1) * sizeof(uint32_t);
+    auto items = writer.append(ndf_list.count * item_size);
+    uint32_t ndf_type = packed_type;
+    for (size_t i = 0; i < ndf_list.count; i++) {
+      std::memcpy(items.data() + i * item_size, &ndf_type, sizeof(ndf_type));
+      std::memcpy(items.data() + i * item_size + sizeof(ndf_type),
+                  packed.data() + i * words, words * sizeof(uint32_t));
+    }
+    return;
+  }
+  for (const auto &value : packed_values) {
+    NDFProperty::write_ndfbin_value(root, value, writer);
+  }
+  for (auto &property : m_values) {
     uint32_t ndf_type = property->property_type;
-    stream.write(reinterpret_cast<char *>(&ndf_type), sizeof(ndf_type));
-    property->to_ndfbin(root, stream);
+    writer.write(ndf_type);
+    property->to_ndfbin(root, writer);
   }
 }
 
+size_t NDFPropertyList::size() const {
+  if (!packed.empty()) {
+    return packed.size() / get_packed_item_words(packed_type);
+  }
+  if (!packed_values.empty()) {
+    return packed_values.size();
+  }
+  return m_values.size();
+}
+
+std::vector<std::unique_ptr<NDFProperty>>
+NDFPropertyList::unpacked_values() const {
+  std::vector<std::unique_ptr<NDFProperty>> ret;
+  for (const auto &value : m_values) {
+    ret.push_back(value->get_copy());
+  }
+  for (const auto &value : packed_values) {
+    ret.push_back(from_value(value));
+    ret.back()->property_name = NDFName::list_item;
+  }
+  if (packed.empty()) {
+    return ret;
+  }
+  size_t words = get_packed_item_words(packed_type);
+  for (size_t i = 0; i < size(); i++) {
+    const uint32_t *item = packed.data() + i * words;
+    std::unique_ptr<NDFProperty> property;
+    switch (packed_type) {
+    case NDFPropertyType::Int32: {
+      auto p = std::make_unique<NDFPropertyInt32>();
+      p->value = std::bit_cast<int32_t>(item[0]);
+      property = std::move(p);
+      break;
+    }
+    case NDFPropertyType::UInt32: {
+      auto p = std::make_unique<NDFPropertyUInt32>();
+      p->value = item[0];
+      property = std::move(p);
+      break;
+    }
+    case NDFPropertyType::Float32: {
+      auto p = std::make_unique<NDFPropertyFloat32>();
+      p->value = std::bit_cast<float>(item[0]);
+      property = std::move(p);
+      break;
+    }
+    case NDFPropertyType::F32_vec3: {
+      auto p = std::make_unique<NDFPropertyF32_vec3>();
+      p->x = std::bit_cast<float>(item[0]);
+      p->y = std::bit_cast<float>(item[1]);
+      p->z = std::bit_cast<float>(item[2]);
+      property = std::move(p);
+      break;
+    }
+    default: {
+      throw std::runtime_error(
+          std::format("Unknown packed NDFType: 0x{:02X}", packed_type));
+    }
+    }
+    property->property_name = NDFName::list_item;
+    ret.push_back(std::move(property));
+  }
+  return ret;
+}
+
 #pragma pack(push, 1)
 struct NDF_Map {
   uint32_t count;
 };
 #pragma pack(pop)
 
-void NDFPropertyMap::from_ndfbin(NDF *root, std::istream &stream) {
-  NDF_Map ndf_map;
-  stream.read(reinterpret_cast<char *>(&ndf_map), sizeof(NDF_Map));
+// reads the item as a property, or as a value if it is fixed size and no
+// property was read before
+static std::unique_ptr<NDFProperty>
+read_ndfbin_item(NDF *root, NDFBinReader &reader, bool as_value,
+                 NDFValue &value, NDFName name) {
+  uint32_t ndf_type = reader.read<uint32_t>();
+  if (as_value &&
+      NDFProperty::read_ndfbin_value(ndf_type, root, reader, value)) {
+    return nullptr;
+  }
+  auto ret = NDFProperty::read_ndfbin(ndf_type, root, reader);
+  ret->property_name = name;
+  return ret;
+}
+
+// keeps the key or value if it was already read as a property, creates it
+// from the value otherwise
+static std::unique_ptr<NDFProperty>
+get_unpacked_item(std::unique_ptr<NDFProperty> property, const NDFValue &value,
+                  NDFName name) {
+  if (property) {
+    return property;
+  }
+  auto ret = NDFProperty::from_value(value);
+  ret->property_name = name;
+  return ret;
+}
+
+void NDFPropertyMap::from_ndfbin(NDF *root, NDFBinReader &reader) {
+  NDF_Map ndf_map = reader.read<NDF_Map>();
+  NDFValue key_value;
+  NDFValue value_value;
   for (uint32_t i = 0; i < ndf_map.count; i++) {
-    uint32_t ndf_type = 0xFFFFFFFF;
-    stream.read(reinterpret_cast<char *>(&ndf_type), sizeof(ndf_type));
-    auto key = NDFProperty::get_property_from_ndfbin(ndf_type, stream);
-    key->from_ndfbin(root, stream);
-    key->property_name = "Key";
-    stream.read(reinterpret_cast<char *>(&ndf_type), sizeof(ndf_type));
-    auto value = NDFProperty::get_property_from_ndfbin(ndf_type, stream);
-    value->from_ndfbin(root, stream);
-    value->property_name = "Value";
-    values.push_back(std::make_pair(std::move(key), std::move(value)));
+    auto key = read_ndfbin_item(root, reader, m_values.empty(), key_value,
+                                NDFName::key);
+    auto value = read_ndfbin_item(root, reader, m_values.empty(), value_value,
+                                  NDFName::value);
+    if (!key && !value) {
+      // see NDFPropertyList::from_ndfbin
+      if (packed_values.empty()) {
+        packed_values.reserve(std::min<size_t>(
+            ndf_map.count, reader.remaining() / (2 * sizeof(uint32_t)) + 1));
+      }
+      packed_values.emplace_back(key_value, value_value);
+      continue;
+    }
+    unpack();
+    m_values.emplace_back(
+        get_unpacked_item(std::move(key), key_value, NDFName::key),
+        get_unpacked_item(std::move(value), value_value, NDFName::value));
+  }
+}
+
+NDFPropertyMap::Entries NDFPropertyMap::unpacked_values() const {
+  Entries ret;
+  for (const auto &[key, value] : m_values) {
+    ret.emplace_back(key->get_copy(), value->get_copy());
+  }
+  for (const auto &[key, value] : packed_values) {
+    ret.emplace_back(get_unpacked_item(nullptr, key, NDFName::key),
+                     get_unpacked_item(nullptr, value, NDFName::value));
   }
+  return ret;
 }
 
-void NDFPropertyMap::to_ndfbin(NDF *root, std::ostream &stream) const {
+void NDFPropertyMap::to_ndfbin(NDF *root, NDFBinWriter &writer) const {
   NDF_Map ndf_map;
-  ndf_map.count = values.size();
-  stream.write(reinterpret_cast<char *>(&ndf_map), sizeof(NDF_Map));
-  for (auto &[key, value] : values) {
+  ndf_map.count = size();
+  writer.write(ndf_map);
+  for (const auto &[key, value] : packed_values) {
+    NDFProperty::write_ndfbin_value(root, key, writer);
+    NDFProperty::write_ndfbin_value(root, value, writer);
+  }
+  for (auto &[key, value] : m_values) {
     uint32_t ndf_type = key->property_type;
-    stream.write(reinterpret_cast<char *>(&ndf_type), sizeof(ndf_type));
-    key->to_ndfbin(root, stream);
+    writer.write(ndf_type);
+    key->to_ndfbin(root, writer);
     ndf_type = value->property_type;
-    stream.write(reinterpret_cast<char *>(&ndf_type), sizeof(ndf_type));
-    value->to_ndfbin(root, stream);
+    writer.write(ndf_type);
+    value->to_ndfbin(root, writer);
   }
 }
 
@@ -392,15 +570,14 @@ struct NDF_Int16 {
 };
 #pragma pack(pop)
 
-void NDFPropertyInt16::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_Int16 ndf_s16;
-  stream.read(reinterpret_cast<char *>(&ndf_s16), sizeof(NDF_Int16));
+void NDFPropertyInt16::from_ndfbin(NDF *, NDFBinReader &reader) {
+  NDF_Int16 ndf_s16 = reader.read<NDF_Int16>();
   value = ndf_s16.value;
 }
-void NDFPropertyInt16::to_ndfbin(NDF *, std::ostream &stream) const {
+void NDFPropertyInt16::to_ndfbin(NDF *, NDFBinWriter &writer) const {
   NDF_Int16 ndf_s16;
   ndf_s16.value = value;
-  stream.write(reinterpret_cast<char *>(&ndf_s16), sizeof(NDF_Int16));
+  writer.write(ndf_s16);
 }
 
 #pragma pack(push, 1)
@@ -409,15 +586,14 @@ struct NDF_UInt16 {
 };
 #pragma pack(pop)
 
-void NDFPropertyUInt16::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_UInt16 ndf_u16;
-  stream.read(reinterpret_cast<char *>(&ndf_u16), sizeof(NDF_UInt16));
+void NDFPropertyUInt16::from_ndfbin(NDF *, NDFBinReader &reader) {
+  NDF_UInt16 ndf_u16 = reader.read<NDF_UInt16>();
   value = ndf_u16.value;
 }
-void NDFPropertyUInt16::to_ndfbin(NDF *, std::ostream &stream) const {
+void NDFPropertyUInt16::to_ndfbin(NDF *, NDFBinWriter &writer) const {
   NDF_UInt16 ndf_u16;
   ndf_u16.value = value;
-  stream.write(reinterpret_cast<char *>(&ndf_u16), sizeof(NDF_UInt16));
+  writer.write(ndf_u16);
 }
 
 #pragma pack(push, 1)
@@ -426,21 +602,14 @@ struct NDF_GUID {
 };
 #pragma pack(pop)
 
-void NDFPropertyGUID::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_GUID ndf_guid;
-  stream.read(reinterpret_cast<char *>(&ndf_guid), sizeof(NDF_GUID));
-  guid = "";
-  for (auto const &byte : ndf_guid.guid) {
-    guid += std::format("{:02X}", byte);
-  }
+void NDFPropertyGUID::from_ndfbin(NDF *, NDFBinReader &reader) {
+  NDF_GUID ndf_guid = reader.read<NDF_GUID>();
+  std::memcpy(guid.data(), ndf_guid.guid, sizeof(ndf_guid.guid));
 }
-void NDFPropertyGUID::to_ndfbin(NDF *, std::ostream &stream) const {
+void NDFPropertyGUID::to_ndfbin(NDF *, NDFBinWriter &writer) const {
   NDF_GUID ndf_guid;
-  for (uint32_t i = 0; i < 16; i++) {
-    std::from_chars(guid.c_str() + i * 2, guid.c_str() + i * 2 + 2,
-                    ndf_guid.guid[i], 16);
-  }
-  stream.write(reinterpret_cast<char *>(&ndf_guid), sizeof(NDF_GUID));
+  std::memcpy(ndf_guid.guid, guid.data(), sizeof(ndf_guid.guid));
+  writer.write(ndf_guid);
 }
 
 #pragma pack(push, 1)
@@ -449,19 +618,16 @@ struct NDF_PathReference {
 };
 #pragma pack(pop)
 
-void NDFPropertyPathReference::from_ndfbin(NDF *root, std::istream &stream) {
-  NDF_PathReference ndf_path_reference;
-  stream.read(reinterpret_cast<char *>(&ndf_path_reference),
-              sizeof(NDF_PathReference));
-  path = root->string_table[ndf_path_reference.path_index];
+void NDFPropertyPathReference::from_ndfbin(NDF *root, NDFBinReader &reader) {
+  NDF_PathReference ndf_path_reference = reader.read<NDF_PathReference>();
+  path = root->string_table.at(ndf_path_reference.path_index);
 }
 
 void NDFPropertyPathReference::to_ndfbin(NDF *root,
-                                         std::ostream &stream) const {
+                                         NDFBinWriter &writer) const {
   NDF_PathReference ndf_path_reference;
-  ndf_path_reference.path_index = root->get_or_add_string(path);
-  stream.write(reinterpret_cast<char *>(&ndf_path_reference),
-               sizeof(NDF_PathReference));
+  ndf_path_reference.path_index = root->get_string_index(writer, path);
+  writer.write(ndf_path_reference);
 }
 
 #pragma pack(push, 1)
@@ -470,23 +636,14 @@ struct NDF_LocalisationHash {
 };
 #pragma pack(pop)
 
-void NDFPropertyLocalisationHash::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_LocalisationHash ndf_hash;
-  stream.read(reinterpret_cast<char *>(&ndf_hash),
-              sizeof(NDF_LocalisationHash));
-  hash = "";
-  for (auto const &byte : ndf_hash.hash) {
-    hash += std::format("{:02X}", byte);
-  }
+void NDFPropertyLocalisationHash::from_ndfbin(NDF *, NDFBinReader &reader) {
+  NDF_LocalisationHash ndf_hash = reader.read<NDF_LocalisationHash>();
+  std::memcpy(hash.data(), ndf_hash.hash, sizeof(ndf_hash.hash));
 }
-void NDFPropertyLocalisationHash::to_ndfbin(NDF *, std::ostream &stream) const {
+void NDFPropertyLocalisationHash::to_ndfbin(NDF *, NDFBinWriter &writer) const {
   NDF_LocalisationHash ndf_hash;
-  for (uint32_t i = 0; i < 8; i++) {
-    std::from_chars(hash.c_str() + i * 2, hash.c_str() + i * 2 + 2,
-                    ndf_hash.hash[i], 16);
-  }
-  stream.write(reinterpret_cast<char *>(&ndf_hash),
-               sizeof(NDF_LocalisationHash));
+  std::memcpy(ndf_hash.hash, hash.data(), sizeof(ndf_hash.hash));
+  writer.write(ndf_hash);
 }
 
 #pragma pack(push, 1)
@@ -496,17 +653,16 @@ struct NDF_S32_vec2 {
 };
 #pragma pack(pop)
 
-void NDFPropertyS32_vec2::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_S32_vec2 ndf_s32_vec2;
-  stream.read(reinterpret_cast<char *>(&ndf_s32_vec2), sizeof(NDF_S32_vec2));
+void NDFPropertyS32_vec2::from_ndfbin(NDF *, NDFBinReader &reader) {
+  NDF_S32_vec2 ndf_s32_vec2 = reader.read<NDF_S32_vec2>();
   x = ndf_s32_vec2.x;
   y = ndf_s32_vec2.y;
 }
-void NDFPropertyS32_vec2::to_ndfbin(NDF *, std::ostream &stream) const {
+void NDFPropertyS32_vec2::to_ndfbin(NDF *, NDFBinWriter &writer) const {
   NDF_S32_vec2 ndf_s32_vec2;
   ndf_s32_vec2.x = x;
   ndf_s32_vec2.y = y;
-  stream.write(reinterpret_cast<char *>(&ndf_s32_vec2), sizeof(NDF_S32_vec2));
+  writer.write(ndf_s32_vec2);
 }
 
 #pragma pack(push, 1)
@@ -516,38 +672,50 @@ struct NDF_F32_vec2 {
 };
 #pragma pack(pop)
 
-void NDFPropertyF32_vec2::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_F32_vec2 ndf_f32_vec2;
-  stream.read(reinterpret_cast<char *>(&ndf_f32_vec2), sizeof(NDF_F32_vec2));
+void NDFPropertyF32_vec2::from_ndfbin(NDF *, NDFBinReader &reader) {
+  NDF_F32_vec2 ndf_f32_vec2 = reader.read<NDF_F32_vec2>();
   x = ndf_f32_vec2.x;
   y = ndf_f32_vec2.y;
 }
-void NDFPropertyF32_vec2::to_ndfbin(NDF *, std::ostream &stream) const {
+void NDFPropertyF32_vec2::to_ndfbin(NDF *, NDFBinWriter &writer) const {
   NDF_F32_vec2 ndf_f32_vec2;
   ndf_f32_vec2.x = x;
   ndf_f32_vec2.y = y;
-  stream.write(reinterpret_cast<char *>(&ndf_f32_vec2), sizeof(NDF_F32_vec2));
+  writer.write(ndf_f32_vec2);
 }
 
-void NDFPropertyPair::from_ndfbin(NDF *root, std::istream &stream) {
-  uint32_t ndf_type = 0xFFFFFFFF;
-  stream.read(reinterpret_cast<char *>(&ndf_type), sizeof(ndf_type));
-  first = NDFProperty::get_property_from_ndfbin(ndf_type, stream);
-  first->from_ndfbin(root, stream);
-  first->property_name = "First";
-  stream.read(reinterpret_cast<char *>(&ndf_type), sizeof(ndf_type));
-  second = NDFProperty::get_property_from_ndfbin(ndf_type, stream);
-  second->from_ndfbin(root, stream);
-  second->property_name = "Second";
+void NDFPropertyPair::from_ndfbin(NDF *root, NDFBinReader &reader) {
+  NDFValue first_value;
+  NDFValue second_value;
+  first = read_ndfbin_item(root, reader, true, first_value, NDFName::first);
+  second =
+      read_ndfbin_item(root, reader, true, second_value, NDFName::second);
+  if (!first && !second) {
+    packed_values.emplace(first_value, second_value);
+    return;
+  }
+  first = get_unpacked_item(std::move(first), first_value, NDFName::first);
+  second = get_unpacked_item(std::move(second), second_value, NDFName::second);
+}
+
+std::pair<std::unique_ptr<NDFProperty>, std::unique_ptr<NDFProperty>>
+NDFPropertyPair::unpacked_values() const {
+  return {get_unpacked_item(nullptr, packed_values->first, NDFName::first),
+          get_unpacked_item(nullptr, packed_values->second, NDFName::second)};
 }
 
-void NDFPropertyPair::to_ndfbin(NDF *root, std::ostream &stream) const {
+void NDFPropertyPair::to_ndfbin(NDF *root, NDFBinWriter &writer) const {
+  if (is_packed()) {
+    NDFProperty::write_ndfbin_value(root, packed_values->first, writer);
+    NDFProperty::write_ndfbin_value(root, packed_values->second, writer);
+    return;
+  }
   uint32_t ndf_type = first->property_type;
-  stream.write(reinterpret_cast<char *>(&ndf_type), sizeof(ndf_type));
-  first->to_ndfbin(root, stream);
+  writer.write(ndf_type);
+  first->to_ndfbin(root, writer);
   ndf_type = second->property_type;
-  stream.write(reinterpret_cast<char *>(&ndf_type), sizeof(ndf_type));
-  second->to_ndfbin(root, stream);
+  writer.write(ndf_type);
+  second->to_ndfbin(root, writer);
 }
 
 #pragma pack(push, 1)
@@ -556,19 +724,478 @@ struct NDF_Hash {
 };
 #pragma pack(pop)
 
-void NDFPropertyHash::from_ndfbin(NDF *, std::istream &stream) {
+void NDFPropertyHash::from_ndfbin(NDF *, NDFBinReader &reader) {
+  NDF_Hash ndf_hash = reader.read<NDF_Hash>();
+  std::memcpy(hash.data(), ndf_hash.hash, sizeof(ndf_hash.hash));
+}
+void NDFPropertyHash::to_ndfbin(NDF *, NDFBinWriter &writer) const {
   NDF_Hash ndf_hash;
-  stream.read(reinterpret_cast<char *>(&ndf_hash), sizeof(NDF_Hash));
-  hash = "";
-  for (auto const &byte : ndf_hash.hash) {
-    hash += std::format("{:02X}", byte);
+  std::memcpy(ndf_hash.hash, hash.data(), sizeof(ndf_hash.hash));
+  writer.write(ndf_hash);
+}
+
+// the decoders below are looked up in a table indexed by NDFPropertyType
+// instead of going through get_property_from_ndftype and a virtual
+// from_ndfbin call. every entry knows the concrete type, so from_ndfbin is
+// called non-virtually and gets inlined into the decoder.
+namespace {
+using NDFBinDecoder = std::unique_ptr<NDFProperty> (*)(NDF *, NDFBinReader &);
+
+struct NDFBinTypeInfo {
+  // size of the payload in bytes, 0 for variable sized types
+  uint32_t size = 0;
+  NDFBinDecoder decode = nullptr;
+};
+
+template <typename T>
+std::unique_ptr<NDFProperty> decode_ndfbin(NDF *root, NDFBinReader &reader) {
+  auto ret = std::make_unique<T>();
+  ret->T::from_ndfbin(root, reader);
+  return ret;
+}
+
+std::unique_ptr<NDFProperty> decode_ndfbin_reference(NDF *root,
+                                                     NDFBinReader &reader) {
+  uint32_t reference_type = reader.read<uint32_t>();
+  if (reference_type == ReferenceType::Object) {
+    return decode_ndfbin<NDFPropertyObjectReference>(root, reader);
+  } else if (reference_type == ReferenceType::Import) {
+    return decode_ndfbin<NDFPropertyImportReference>(root, reader);
   }
+  throw std::runtime_error(
+      std::format("Unknown ReferenceType: {}", reference_type));
 }
-void NDFPropertyHash::to_ndfbin(NDF *, std::ostream &stream) const {
-  NDF_Hash ndf_hash;
-  for (uint32_t i = 0; i < 8; i++) {
-    std::from_chars(hash.c_str() + i * 2, hash.c_str() + i * 2 + 2,
-                    ndf_hash.hash[i], 16);
+
+// fixed size types are read as a single packed struct, the size is only
+// needed for skipping
+template <typename T, typename Packed> constexpr NDFBinTypeInfo fixed() {
+  return {sizeof(Packed), &decode_ndfbin<T>};
+}
+template <typename T> constexpr NDFBinTypeInfo variable() {
+  return {0, &decode_ndfbin<T>};
+}
+
+constexpr auto ndfbin_types = [] {
+  std::array<NDFBinTypeInfo, NDFPropertyType::Hash + 1> table{};
+  table[NDFPropertyType::Bool] = fixed<NDFPropertyBool, NDF_Bool>();
+  table[NDFPropertyType::UInt8] = fixed<NDFPropertyUInt8, NDF_UInt8>();
+  table[NDFPropertyType::Int32] = fixed<NDFPropertyInt32, NDF_Int32>();
+  table[NDFPropertyType::UInt32] = fixed<NDFPropertyUInt32, NDF_UInt32>();
+  table[NDFPropertyType::Float32] = fixed<NDFPropertyFloat32, NDF_Float32>();
+  table[NDFPropertyType::Float64] = fixed<NDFPropertyFloat64, NDF_Float64>();
+  table[NDFPropertyType::String] = fixed<NDFPropertyString, NDF_String>();
+  table[NDFPropertyType::WideString] = variable<NDFPropertyWideString>();
+  table[0x9] = {0, &decode_ndfbin_reference};
+  table[NDFPropertyType::F32_vec3] =
+      fixed<NDFPropertyF32_vec3, NDF_F32_vec3>();
+  table[NDFPropertyType::F32_vec4] =
+      fixed<NDFPropertyF32_vec4, NDF_F32_vec4>();
+  table[NDFPropertyType::Color] = fixed<NDFPropertyColor, NDF_Color>();
+  table[NDFPropertyType::S32_vec3] =
+      fixed<NDFPropertyS32_vec3, NDF_S32_vec3>();
+  table[NDFPropertyType::List] = variable<NDFPropertyList>();
+  table[NDFPropertyType::Map] = variable<NDFPropertyMap>();
+  table[NDFPropertyType::Int16] = fixed<NDFPropertyInt16, NDF_Int16>();
+  table[NDFPropertyType::UInt16] = fixed<NDFPropertyUInt16, NDF_UInt16>();
+  table[NDFPropertyType::NDFGUID] = fixed<NDFPropertyGUID, NDF_GUID>();
+  table[NDFPropertyType::PathReference] =
+      fixed<NDFPropertyPathReference, NDF_PathReference>();
+  table[NDFPropertyType::LocalisationHash] =
+      fixed<NDFPropertyLocalisationHash, NDF_LocalisationHash>();
+  table[NDFPropertyType::S32_vec2] =
+      fixed<NDFPropertyS32_vec2, NDF_S32_vec2>();
+  table[NDFPropertyType::F32_vec2] =
+      fixed<NDFPropertyF32_vec2, NDF_F32_vec2>();
+  table[NDFPropertyType::Pair] = variable<NDFPropertyPair>();
+  table[NDFPropertyType::Hash] = fixed<NDFPropertyHash, NDF_Hash>();
+  return table;
+}();
+
+const NDFBinTypeInfo &get_ndfbin_type(uint32_t ndf_type) {
+  if (ndf_type >= ndfbin_types.size() ||
+      ndfbin_types[ndf_type].decode == nullptr) {
+    throw std::runtime_error(
+        std::format("Unknown NDFType: 0x{:02X}", ndf_type));
+  }
+  return ndfbin_types[ndf_type];
+}
+} // namespace
+
+std::unique_ptr<NDFProperty>
+NDFProperty::read_ndfbin(uint32_t ndf_type, NDF *root, NDFBinReader &reader) {
+  spdlog::debug("NDFType: {} @0x{:02X}", ndf_type, (uint32_t)reader.tell());
+  return get_ndfbin_type(ndf_type).decode(root, reader);
+}
+
+// advances the reader over a property value without decoding it, used to
+// index the OBJE section
+void NDFProperty::skip_ndfbin(uint32_t ndf_type, NDFBinReader &reader) {
+  const auto &type = get_ndfbin_type(ndf_type);
+  if (type.size != 0) {
+    reader.skip(type.size);
+    return;
+  }
+  switch (ndf_type) {
+  case NDFPropertyType::WideString: {
+    reader.skip(reader.read<uint32_t>());
+    break;
+  }
+  case 0x9: {
+    uint32_t reference_type = reader.read<uint32_t>();
+    if (reference_type == ReferenceType::Object) {
+      reader.skip(sizeof(NDF_ObjectReference));
+    } else if (reference_type == ReferenceType::Import) {
+      reader.skip(sizeof(NDF_ImportReference));
+    } else {
+      throw std::runtime_error(
+          std::format("Unknown ReferenceType: {}", reference_type));
+    }
+    break;
+  }
+  case NDFPropertyType::List: {
+    uint32_t count = reader.read<uint32_t>();
+    for (uint32_t i = 0; i < count; i++) {
+      skip_ndfbin(reader.read<uint32_t>(), reader);
+    }
+    break;
+  }
+  case NDFPropertyType::Map: {
+    uint32_t count = reader.read<uint32_t>();
+    for (uint32_t i = 0; i < count; i++) {
+      skip_ndfbin(reader.read<uint32_t>(), reader);
+      skip_ndfbin(reader.read<uint32_t>(), reader);
+    }
+    break;
+  }
+  case NDFPropertyType::Pair: {
+    skip_ndfbin(reader.read<uint32_t>(), reader);
+    skip_ndfbin(reader.read<uint32_t>(), reader);
+    break;
+  }
+  default: {
+    throw std::runtime_error(
+        std::format("Unknown NDFType: 0x{:02X}", ndf_type));
+  }
+  }
+}
+
+bool NDFProperty::read_ndfbin_value(uint32_t ndf_type, NDF *root,
+                                    NDFBinReader &reader, NDFValue &value) {
+  switch (ndf_type) {
+  case NDFPropertyType::Bool: {
+    value = reader.read<NDF_Bool>().value != 0;
+    return true;
+  }
+  case NDFPropertyType::UInt8: {
+    value = reader.read<NDF_UInt8>().value;
+    return true;
+  }
+  case NDFPropertyType::Int16: {
+    value = reader.read<NDF_Int16>().value;
+    return true;
+  }
+  case NDFPropertyType::UInt16: {
+    value = reader.read<NDF_UInt16>().value;
+    return true;
+  }
+  case NDFPropertyType::Int32: {
+    value = reader.read<NDF_Int32>().value;
+    return true;
+  }
+  case NDFPropertyType::UInt32: {
+    value = reader.read<NDF_UInt32>().value;
+    return true;
+  }
+  case NDFPropertyType::Float32: {
+    value = reader.read<NDF_Float32>().value;
+    return true;
+  }
+  case NDFPropertyType::Float64: {
+    value = reader.read<NDF_Float64>().value;
+    return true;
+  }
+  case NDFPropertyType::String: {
+    value = NDFStringValue{
+        root->string_table.at(reader.read<NDF_String>().string_index)};
+    return true;
+  }
+  case NDFPropertyType::PathReference: {
+    value = NDFPathValue{
+        root->string_table.at(reader.read<NDF_PathReference>().path_index)};
+    return true;
+  }
+  case 0x9: {
+    uint32_t reference_type = reader.read<uint32_t>();
+    if (reference_type == ReferenceType::Object) {
+      value =
+          NDFObjectValue{reader.read<NDF_ObjectReference>().object_index};
+    } else if (reference_type == ReferenceType::Import) {
+      value = NDFImportValue{root->import_name_table.at(
+          reader.read<NDF_ImportReference>().import_index)};
+    } else {
+      throw std::runtime_error(
+          std::format("Unknown ReferenceType: {}", reference_type));
+    }
+    return true;
+  }
+  case NDFPropertyType::F32_vec2: {
+    auto vec = reader.read<NDF_F32_vec2>();
+    value = std::array<float, 2>{vec.x, vec.y};
+    return true;
+  }
+  case NDFPropertyType::F32_vec3: {
+    auto vec = reader.read<NDF_F32_vec3>();
+    value = std::array<float, 3>{vec.x, vec.y, vec.z};
+    return true;
+  }
+  case NDFPropertyType::F32_vec4: {
+    auto vec = reader.read<NDF_F32_vec4>();
+    value = std::array<float, 4>{vec.x, vec.y, vec.z, vec.w};
+    return true;
+  }
+  case NDFPropertyType::S32_vec2: {
+    auto vec = reader.read<NDF_S32_vec2>();
+    value = std::array<int32_t, 2>{vec.x, vec.y};
+    return true;
+  }
+  case NDFPropertyType::S32_vec3: {
+    auto vec = reader.read<NDF_S32_vec3>();
+    value = std::array<int32_t, 3>{vec.x, vec.y, vec.z};
+    return true;
+  }
+  case NDFPropertyType::Color: {
+    auto color = reader.read<NDF_Color>();
+    value = NDFColorValue{color.b, color.g, color.r, color.a};
+    return true;
+  }
+  case NDFPropertyType::NDFGUID: {
+    NDFGUIDValue guid;
+    std::memcpy(guid.guid.data(), reader.read<NDF_GUID>().guid,
+                guid.guid.size());
+    value = guid;
+    return true;
+  }
+  case NDFPropertyType::LocalisationHash: {
+    NDFLocalisationHashValue hash;
+    std::memcpy(hash.hash.data(), reader.read<NDF_LocalisationHash>().hash,
+                hash.hash.size());
+    value = hash;
+    return true;
+  }
+  case NDFPropertyType::Hash: {
+    NDFHashValue hash;
+    std::memcpy(hash.hash.data(), reader.read<NDF_Hash>().hash,
+                hash.hash.size());
+    value = hash;
+    return true;
+  }
+  default: {
+    // throws for unknown types
+    get_ndfbin_type(ndf_type);
+    return false;
+  }
+  }
+}
+
+void NDFProperty::write_ndfbin_value(NDF *root, const NDFValue &value,
+                                     NDFBinWriter &writer) {
+  writer.write(get_ndf_value_type(value));
+  std::visit(
+      [&](const auto &v) {
+        using T = std::decay_t<decltype(v)>;
+        if constexpr (std::is_same_v<T, bool>) {
+          writer.write(NDF_Bool{v});
+        } else if constexpr (std::is_same_v<T, NDFStringValue>) {
+          writer.write(NDF_String{root->get_string_index(writer, v.value)});
+        } else if constexpr (std::is_same_v<T, NDFPathValue>) {
+          writer.write(
+              NDF_PathReference{root->get_string_index(writer, v.path)});
+        } else if constexpr (std::is_same_v<T, NDFObjectValue>) {
+          writer.write<uint32_t>(ReferenceType::Object);
+          writer.write(NDF_ObjectReference{
+              v.object_index, root->get_class_of_object(v.object_index)});
+        } else if constexpr (std::is_same_v<T, NDFImportValue>) {
+          writer.write<uint32_t>(ReferenceType::Import);
+          writer.write(NDF_ImportReference{
+              root->get_import_index(writer, v.import_name)});
+        } else {
+          // everything else is stored like the packed NDF_ structs
+          writer.write(v);
+        }
+      },
+      value);
+}
+
+std::unique_ptr<NDFProperty> NDFProperty::from_value(const NDFValue &value) {
+  return std::visit(
+      [](const auto &v) -> std::unique_ptr<NDFProperty> {
+        using T = std::decay_t<decltype(v)>;
+        auto scalar = [&]<typename P>() {
+          auto ret = std::make_unique<P>();
+          ret->value = v;
+          return ret;
+        };
+        if constexpr (std::is_same_v<T, bool>) {
+          return scalar.template operator()<NDFPropertyBool>();
+        } else if constexpr (std::is_same_v<T, uint8_t>) {
+          return scalar.template operator()<NDFPropertyUInt8>();
+        } else if constexpr (std::is_same_v<T, int16_t>) {
+          return scalar.template operator()<NDFPropertyInt16>();
+        } else if constexpr (std::is_same_v<T, uint16_t>) {
+          return scalar.template operator()<NDFPropertyUInt16>();
+        } else if constexpr (std::is_same_v<T, int32_t>) {
+          return scalar.template operator()<NDFPropertyInt32>();
+        } else if constexpr (std::is_same_v<T, uint32_t>) {
+          return scalar.template operator()<NDFPropertyUInt32>();
+        } else if constexpr (std::is_same_v<T, float>) {
+          return scalar.template operator()<NDFPropertyFloat32>();
+        } else if constexpr (std::is_same_v<T, double>) {
+          return scalar.template operator()<NDFPropertyFloat64>();
+        } else if constexpr (std::is_same_v<T, NDFStringValue>) {
+          auto ret = std::make_unique<NDFPropertyString>();
+          ret->value = v.value;
+          return ret;
+        } else if constexpr (std::is_same_v<T, NDFPathValue>) {
+          auto ret = std::make_unique<NDFPropertyPathReference>();
+          ret->path = v.path;
+          return ret;
+        } else if constexpr (std::is_same_v<T, NDFObjectValue>) {
+          auto ret = std::make_unique<NDFPropertyObjectReference>();
+          ret->object_index = v.object_index;
+          return ret;
+        } else if constexpr (std::is_same_v<T, NDFImportValue>) {
+          auto ret = std::make_unique<NDFPropertyImportReference>();
+          ret->import_name = v.import_name;
+          return ret;
+        } else if constexpr (std::is_same_v<T, std::array<float, 2>>) {
+          auto ret = std::make_unique<NDFPropertyF32_vec2>();
+          ret->x = v[0];
+          ret->y = v[1];
+          return ret;
+        } else if constexpr (std::is_same_v<T, std::array<float, 3>>) {
+          auto ret = std::make_unique<NDFPropertyF32_vec3>();
+          ret->x = v[0];
+          ret->y = v[1];
+          ret->z = v[2];
+          return ret;
+        } else if constexpr (std::is_same_v<T, std::array<float, 4>>) {
+          auto ret = std::make_unique<NDFPropertyF32_vec4>();
+          ret->x = v[0];
+          ret->y = v[1];
+          ret->z = v[2];
+          ret->w = v[3];
+          return ret;
+        } else if constexpr (std::is_same_v<T, std::array<int32_t, 2>>) {
+          auto ret = std::make_unique<NDFPropertyS32_vec2>();
+          ret->x = v[0];
+          ret->y = v[1];
+          return ret;
+        } else if constexpr (std::is_same_v<T, std::array<int32_t, 3>>) {
+          auto ret = std::make_unique<NDFPropertyS32_vec3>();
+          ret->x = v[0];
+          ret->y = v[1];
+          ret->z = v[2];
+          return ret;
+        } else if constexpr (std::is_same_v<T, NDFColorValue>) {
+          auto ret = std::make_unique<NDFPropertyColor>();
+          ret->b = v.b;
+          ret->g = v.g;
+          ret->r = v.r;
+          ret->a = v.a;
+          return ret;
+        } else if constexpr (std::is_same_v<T, NDFGUIDValue>) {
+          auto ret = std::make_unique<NDFPropertyGUID>();
+          ret->guid = v.guid;
+          return ret;
+        } else if constexpr (std::is_same_v<T, NDFLocalisationHashValue>) {
+          auto ret = std::make_unique<NDFPropertyLocalisationHash>();
+          ret->hash = v.hash;
+          return ret;
+        } else {
+          static_assert(std::is_same_v<T, NDFHashValue>);
+          auto ret = std::make_unique<NDFPropertyHash>();
+          ret->hash = v.hash;
+          return ret;
+        }
+      },
+      value);
+}
+
+void NDFProperty::visit_ndfbin(NDF *root, std::string_view name,
+                               uint32_t ndf_type, NDFBinReader &reader,
+                               NDFBinVisitor &visitor) {
+  switch (ndf_type) {
+  case NDFPropertyType::List: {
+    uint32_t count = reader.read<NDF_List>().count;
+    visitor.begin_list(name, count);
+    for (uint32_t i = 0; i < count; i++) {
+      visit_ndfbin(root, "ListItem", reader.read<uint32_t>(), reader, visitor);
+    }
+    visitor.end_list(name);
+    return;
+  }
+  case NDFPropertyType::Map: {
+    uint32_t count = reader.read<NDF_Map>().count;
+    visitor.begin_map(name, count);
+    for (uint32_t i = 0; i < count; i++) {
+      visit_ndfbin(root, "Key", reader.read<uint32_t>(), reader, visitor);
+      visit_ndfbin(root, "Value", reader.read<uint32_t>(), reader, visitor);
+    }
+    visitor.end_map(name);
+    return;
+  }
+  case NDFPropertyType::Pair: {
+    visitor.begin_pair(name);
+    visit_ndfbin(root, "First", reader.read<uint32_t>(), reader, visitor);
+    visit_ndfbin(root, "Second", reader.read<uint32_t>(), reader, visitor);
+    visitor.end_pair(name);
+    return;
+  }
+  default:
+    break;
+  }
+
+  NDFBinValue value;
+  value.type = ndf_type;
+  size_t begin = reader.tell();
+  switch (ndf_type) {
+  case NDFPropertyType::String: {
+    value.string =
+        root->string_table.at(reader.read<NDF_String>().string_index);
+    break;
+  }
+  case NDFPropertyType::PathReference: {
+    value.string =
+        root->string_table.at(reader.read<NDF_PathReference>().path_index);
+    break;
+  }
+  case NDFPropertyType::WideString: {
+    uint32_t length = reader.read<uint32_t>();
+    begin = reader.tell();
+    reader.skip(length);
+    break;
+  }
+  case 0x9: {
+    uint32_t reference_type = reader.read<uint32_t>();
+    begin = reader.tell();
+    if (reference_type == ReferenceType::Object) {
+      value.is_object_reference = true;
+      value.object_index = reader.read<NDF_ObjectReference>().object_index;
+    } else if (reference_type == ReferenceType::Import) {
+      value.is_import_reference = true;
+      value.string = root->import_name_table.at(
+          reader.read<NDF_ImportReference>().import_index);
+    } else {
+      throw std::runtime_error(
+          std::format("Unknown ReferenceType: {}", reference_type));
+    }
+    break;
+  }
+  default: {
+    reader.skip(get_ndfbin_type(ndf_type).size);
+    break;
+  }
   }
-  stream.write(reinterpret_cast<char *>(&ndf_hash), sizeof(NDF_Hash));
+  value.data = reader.data().subspan(begin, reader.tell() - begin);
+  visitor.property(name, value);
 }
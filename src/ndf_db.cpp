@@ -449,9 +449,10 @@ std::optional<size_t> NDF_DB::insert_object(NDFObject &object) {
     return std::nullopt;
   }
 
-  for (auto &prop : object.properties) {
-    prop->db_object_id = object_id.value();
-    insert_property(*prop);
+  for (auto &property : object.m_properties) {
+    NDFProperty &prop = property.edit();
+    prop.db_object_id = object_id.value();
+    insert_property(prop);
   }
   return object_id;
 }
@@ -523,7 +524,7 @@ std::optional<NDFObject> NDF_DB::get_object(size_t object_idx) {
   for (auto prop_id : prop_ids_opt.value()) {
     auto prop_opt = get_property(prop_id);
     if (prop_opt) {
-      ret.properties.push_back(std::move(prop_opt.value()));
+      ret.add_property(std::move(prop_opt.value()));
     } else {
       return std::nullopt;
     }
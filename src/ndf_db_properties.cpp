@@ -63,22 +63,22 @@ std::optional<int> NDFProperty::add_db_property(NDF_DB *db) const {
   if (!db_parent) {
     if (!db_value_id) {
       prop_id = db->stmt_insert_ndf_property.insert(
-          db_object_id, property_name, property_idx, SQLNULL{}, SQLNULL{},
+          db_object_id, property_name.str(), property_idx, SQLNULL{}, SQLNULL{},
           property_type, is_import_reference(), SQLNULL{});
     } else {
       prop_id = db->stmt_insert_ndf_property.insert(
-          db_object_id, property_name, property_idx, SQLNULL{}, SQLNULL{},
+          db_object_id, property_name.str(), property_idx, SQLNULL{}, SQLNULL{},
           property_type, is_import_reference(), db_value_id.value());
     }
   } else {
     assert(db_position.has_value());
     if (!db_value_id) {
       prop_id = db->stmt_insert_ndf_property.insert(
-          db_object_id, property_name, property_idx, db_parent.value(),
+          db_object_id, property_name.str(), property_idx, db_parent.value(),
           db_position.value(), property_type, is_import_reference(), SQLNULL{});
     } else {
       prop_id = db->stmt_insert_ndf_property.insert(
-          db_object_id, property_name, property_idx, db_parent.value(),
+          db_object_id, property_name.str(), property_idx, db_parent.value(),
           db_position.value(), property_type, is_import_reference(),
           db_value_id.value());
     }
@@ -533,6 +533,7 @@ bool NDFPropertyObjectReference::from_ndf_db(NDF_DB *db, int property_id) {
     return false;
   }
   auto [referenced_object, optional_value] = value_opt.value();
+  object_index = no_object;
   if (referenced_object != 0) {
     // get the object_name from the referenced object_id, needs to exist
     auto object_name_opt =
@@ -551,8 +552,8 @@ bool NDFPropertyObjectReference::from_ndf_db(NDF_DB *db, int property_id) {
 
 bool NDFPropertyObjectReference::to_ndf_db(NDF_DB *db) {
   // object not found, so insert only the optional_value
-  db_value_id =
-      db->stmt_insert_ndf_object_reference.insert(SQLNULL{}, object_name);
+  db_value_id = db->stmt_insert_ndf_object_reference.insert(SQLNULL{},
+                                                             get_object_name());
   return db_value_id.has_value();
 }
 
@@ -560,6 +561,7 @@ bool NDFPropertyObjectReference::change_value(NDF_DB *db, int property_id,
                                               std::string new_value) {
   auto ret =
       db->stmt_set_object_reference_value.execute(new_value, property_id);
+  object_index = no_object;
   object_name = new_value;
   return ret;
 }
@@ -570,19 +572,19 @@ bool NDFPropertyGUID::from_ndf_db(NDF_DB *db, int property_id) {
   if (!value_opt) {
     return false;
   }
-  guid = value_opt.value();
+  guid = hex_to_bytes<16>(value_opt.value());
   return true;
 }
 
 bool NDFPropertyGUID::to_ndf_db(NDF_DB *db) {
-  db_value_id = db->stmt_insert_ndf_GUID.insert(guid);
+  db_value_id = db->stmt_insert_ndf_GUID.insert(bytes_to_hex(guid));
   return db_value_id.has_value();
 }
 
 bool NDFPropertyGUID::change_value(NDF_DB *db, int property_id,
                                    std::string new_value) {
+  guid = hex_to_bytes<16>(new_value);
   auto ret = db->stmt_set_GUID_value.execute(new_value, property_id);
-  guid = new_value;
   return ret;
 }
 
@@ -617,21 +619,22 @@ bool NDFPropertyLocalisationHash::from_ndf_db(NDF_DB *db, int property_id) {
   if (!value_opt) {
     return false;
   }
-  hash = value_opt.value();
+  hash = hex_to_bytes<8>(value_opt.value());
   return true;
 }
 
 bool NDFPropertyLocalisationHash::to_ndf_db(NDF_DB *db) {
   // insert the value in the bool table
-  db_value_id = db->stmt_insert_ndf_localisation_hash.insert(hash);
+  db_value_id =
+      db->stmt_insert_ndf_localisation_hash.insert(bytes_to_hex(hash));
   return db_value_id.has_value();
 }
 
 bool NDFPropertyLocalisationHash::change_value(NDF_DB *db, int property_id,
                                                std::string new_value) {
+  hash = hex_to_bytes<8>(new_value);
   auto ret =
       db->stmt_set_localisation_hash_value.execute(new_value, property_id);
-  hash = new_value;
   return ret;
 }
 
@@ -641,20 +644,20 @@ bool NDFPropertyHash::from_ndf_db(NDF_DB *db, int property_id) {
   if (!value_opt) {
     return false;
   }
-  hash = value_opt.value();
+  hash = hex_to_bytes<16>(value_opt.value());
   return true;
 }
 
 bool NDFPropertyHash::to_ndf_db(NDF_DB *db) {
   // insert the value in the bool table
-  db_value_id = db->stmt_insert_ndf_hash.insert(hash);
+  db_value_id = db->stmt_insert_ndf_hash.insert(bytes_to_hex(hash));
   return db_value_id.has_value();
 }
 
 bool NDFPropertyHash::change_value(NDF_DB *db, int property_id,
                                    std::string new_value) {
+  hash = hex_to_bytes<16>(new_value);
   auto ret = db->stmt_set_hash_value.execute(new_value, property_id);
-  hash = new_value;
   return ret;
 }
 
@@ -670,7 +673,7 @@ bool NDFPropertyList::from_ndf_db(NDF_DB *db, int property_id) {
     // now get the corresponding properties and initialize them
     auto prop = get_db_property_type(db, prop_id, pos);
     prop->from_ndf_db(db, prop_id);
-    values.push_back(std::move(prop));
+    m_values.push_back(std::move(prop));
   }
   return true;
 }
@@ -679,11 +682,12 @@ bool NDFPropertyList::to_ndf_db(NDF_DB *db) {
   int pos = 0;
   auto prop_id_opt = add_db_property(db);
   if (!prop_id_opt) {
-    spdlog::error("Couldn't add property {}", property_name);
+    spdlog::error("Couldn't add property {}", property_name.str());
     return false;
   }
   int prop_id = prop_id_opt.value();
-  for (auto &prop : values) {
+  // the db stores the items as properties
+  for (auto &prop : values()) {
     prop->db_parent = prop_id;
     prop->db_position = pos;
     // insert the property into the db
@@ -727,7 +731,7 @@ bool NDFPropertyMap::from_ndf_db(NDF_DB *db, int property_id) {
     pos += 1;
     prop_it++;
 
-    values.push_back({std::move(key_prop), std::move(value_prop)});
+    m_values.push_back({std::move(key_prop), std::move(value_prop)});
   }
   return true;
 }
@@ -737,11 +741,12 @@ bool NDFPropertyMap::to_ndf_db(NDF_DB *db) {
   // first we insert the property for us in the table
   auto prop_id_opt = add_db_property(db);
   if (!prop_id_opt) {
-    spdlog::error("Couldn't add property {}", property_name);
+    spdlog::error("Couldn't add property {}", property_name.str());
     return false;
   }
   int prop_id = prop_id_opt.value();
-  for (auto &[key, value] : values) {
+  // see NDFPropertyList::to_ndf_db
+  for (auto &[key, value] : values()) {
     // insert the property into the db
     key->db_parent = prop_id;
     key->db_position = pos;
@@ -806,11 +811,12 @@ bool NDFPropertyPair::from_ndf_db(NDF_DB *db, int property_id) {
 }
 
 bool NDFPropertyPair::to_ndf_db(NDF_DB *db) {
+  unpack();
   int pos = 0;
   // first we insert the property for us in the table
   auto prop_id_opt = add_db_property(db);
   if (!prop_id_opt) {
-    spdlog::error("Couldn't add property {}", property_name);
+    spdlog::error("Couldn't add property {}", property_name.str());
     return false;
   }
   int prop_id = prop_id_opt.value();
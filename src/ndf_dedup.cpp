@@ -0,0 +1,160 @@
+#include "ndf_dedup.hpp"
+#include "ndf_property_walker.hpp"
+
+#include <array>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+// canonical encoding of a property tree, two properties with the same key
+// are identical. also estimates the memory of the tree.
+struct NDFPropertyKeyBuilder : NDFPropertyWalker<NDFPropertyKeyBuilder> {
+  std::string key;
+  size_t bytes = 0;
+
+  template <typename T> void add(const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    key.append(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+  void add_string(std::string_view str) {
+    add<uint64_t>(str.size());
+    key.append(str);
+  }
+  // strings owned by the property, long ones are on the heap
+  void add_owned_string(const std::string &str) {
+    add_string(str);
+    if (str.capacity() > std::string().capacity()) {
+      bytes += str.capacity() + 1;
+    }
+  }
+  template <typename P> void add_node(const P &) {
+    bytes += sizeof(P);
+  }
+
+  // every item starts with a tag, so the key can't be ambiguous
+  enum Tag : uint8_t { Null, Value, Property, Words };
+
+  void begin_property(const NDFProperty &property) {
+    add(Tag::Property);
+    add(property.property_type);
+    add_string(property.property_name);
+  }
+
+  template <typename P> void leaf(const P &p) {
+    add_node(p);
+    if constexpr (std::is_same_v<P, NDFPropertyString> ||
+                  std::is_same_v<P, NDFPropertyWideString>) {
+      add_owned_string(p.value);
+    } else if constexpr (std::is_same_v<P, NDFPropertyObjectReference>) {
+      // object and import references have the same type
+      add<uint8_t>(1);
+      add(p.object_index);
+      add_owned_string(p.object_name);
+    } else if constexpr (std::is_same_v<P, NDFPropertyImportReference>) {
+      add<uint8_t>(0);
+      add_owned_string(p.import_name);
+    } else if constexpr (std::is_same_v<P, NDFPropertyPathReference>) {
+      add_owned_string(p.path);
+    } else if constexpr (std::is_same_v<P, NDFPropertyF32_vec2> ||
+                         std::is_same_v<P, NDFPropertyS32_vec2>) {
+      add(std::array{p.x, p.y});
+    } else if constexpr (std::is_same_v<P, NDFPropertyF32_vec3> ||
+                         std::is_same_v<P, NDFPropertyS32_vec3>) {
+      add(std::array{p.x, p.y, p.z});
+    } else if constexpr (std::is_same_v<P, NDFPropertyF32_vec4>) {
+      add(std::array{p.x, p.y, p.z, p.w});
+    } else if constexpr (std::is_same_v<P, NDFPropertyColor>) {
+      add(std::array{p.b, p.g, p.r, p.a});
+    } else if constexpr (std::is_same_v<P, NDFPropertyGUID>) {
+      add(p.guid);
+    } else if constexpr (std::is_same_v<P, NDFPropertyLocalisationHash> ||
+                         std::is_same_v<P, NDFPropertyHash>) {
+      add(p.hash);
+    } else {
+      add(p.value);
+    }
+  }
+
+  void value(const NDFValue &value) {
+    add(Tag::Value);
+    add<uint8_t>(value.index());
+    std::visit(
+        [this](const auto &v) {
+          using T = std::decay_t<decltype(v)>;
+          if constexpr (std::is_same_v<T, NDFStringValue>) {
+            add_string(v.value);
+          } else if constexpr (std::is_same_v<T, NDFPathValue>) {
+            add_string(v.path);
+          } else if constexpr (std::is_same_v<T, NDFImportValue>) {
+            add_string(v.import_name);
+          } else {
+            add(v);
+          }
+        },
+        value);
+  }
+  // the raw words are enough, begin_list added the item type
+  void packed_words(const NDFPropertyList &list) {
+    add(Tag::Words);
+    add<uint64_t>(list.packed.size());
+    key.append(reinterpret_cast<const char *>(list.packed.data()),
+               list.packed.size() * sizeof(uint32_t));
+  }
+  void null_item() { add(Tag::Null); }
+
+  bool begin_list(const NDFPropertyList &list) {
+    add_node(list);
+    add(list.packed_type);
+    add<uint64_t>(list.size());
+    bytes += list.packed.capacity() * sizeof(uint32_t) +
+             list.packed_values.capacity() * sizeof(NDFValue);
+    if (!list.is_packed()) {
+      bytes += list.values().capacity() * sizeof(list.values()[0]);
+    }
+    return true;
+  }
+  bool begin_map(const NDFPropertyMap &map) {
+    add_node(map);
+    add<uint64_t>(map.size());
+    bytes += map.packed_values.capacity() * sizeof(map.packed_values[0]);
+    if (!map.is_packed()) {
+      bytes += map.values().capacity() * sizeof(map.values()[0]);
+    }
+    return true;
+  }
+  bool begin_pair(const NDFPropertyPair &pair) {
+    add_node(pair);
+    return true;
+  }
+};
+
+bool NDFPropertyDeduplicator::share(NDFPropertyRef &property,
+                                    std::string_view class_name) {
+  // property indices are per class, so properties are only shared within a
+  // class
+  NDFPropertyKeyBuilder builder;
+  builder.add_string(class_name);
+  builder.walk(*property);
+
+  NDFPropertyRef replaced;
+  {
+    std::lock_guard lock(m_mutex);
+    auto [it, inserted] =
+        m_shared.try_emplace(std::move(builder.key), property);
+    if (inserted || it->second == property) {
+      return false;
+    }
+    auto stats = m_stats.find(class_name);
+    if (stats == m_stats.end()) {
+      stats = m_stats.emplace(class_name, NDFDedupStats()).first;
+    }
+    stats->second.properties++;
+    // still used by clones of the object otherwise
+    if (!property.is_shared()) {
+      stats->second.bytes += builder.bytes;
+    }
+    replaced = std::exchange(property, it->second);
+  }
+  // replaced is released outside of the lock
+  return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ndf_properties.hpp"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+struct NDFDedupStats {
+  // properties replaced by an identical shared one
+  size_t properties = 0;
+  // estimated memory of the replaced properties, including their items
+  size_t bytes = 0;
+};
+
+// hash consing of the list, map and pair properties of objects: identical
+// properties (same class, name, type and items) are replaced by one shared
+// NDFPropertyRef, so they are only copied once changed through
+// NDFObject::edit_property. share() may be called from multiple threads.
+class NDFPropertyDeduplicator {
+private:
+  std::mutex m_mutex;
+  std::unordered_map<std::string, NDFPropertyRef> m_shared;
+  // per class name
+  std::map<std::string, NDFDedupStats, std::less<>> m_stats;
+
+public:
+  // only lists, maps and pairs are worth sharing
+  static bool is_candidate(const NDFProperty &property) {
+    return property.property_type == NDFPropertyType::List ||
+           property.property_type == NDFPropertyType::Map ||
+           property.property_type == NDFPropertyType::Pair;
+  }
+
+  // replaces property with an identical property seen before and returns
+  // true, otherwise remembers it for later calls
+  bool share(NDFPropertyRef &property, std::string_view class_name);
+
+  std::map<std::string, NDFDedupStats, std::less<>> take_stats() {
+    std::lock_guard lock(m_mutex);
+    return std::move(m_stats);
+  }
+};
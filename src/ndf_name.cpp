@@ -0,0 +1,61 @@
+#include "ndf_name.hpp"
+
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
+
+struct NDFNameHash {
+  using is_transparent = void;
+  size_t operator()(std::string_view name) const {
+    return std::hash<std::string_view>()(name);
+  }
+};
+
+// nodes of an unordered_set keep their address, so the pointers stay valid
+// when it rehashes. lookups of names that are already interned, which is
+// almost all of them, only take a shared lock
+struct NDFNamePool {
+  std::shared_mutex mutex;
+  std::unordered_set<std::string, NDFNameHash, std::equal_to<>> names;
+};
+
+static NDFNamePool &get_pool() {
+  static NDFNamePool pool;
+  return pool;
+}
+
+const std::string *NDFName::intern(std::string_view name) {
+  if (name.empty()) {
+    return &m_empty;
+  }
+  auto &pool = get_pool();
+  {
+    std::shared_lock lock(pool.mutex);
+    auto it = pool.names.find(name);
+    if (it != pool.names.end()) {
+      return &*it;
+    }
+  }
+  // another thread may have added it in between, emplace finds it then
+  std::unique_lock lock(pool.mutex);
+  return &*pool.names.emplace(name).first;
+}
+
+std::optional<NDFName> NDFName::find(std::string_view name) {
+  if (name.empty()) {
+    return NDFName();
+  }
+  auto &pool = get_pool();
+  std::shared_lock lock(pool.mutex);
+  auto it = pool.names.find(name);
+  if (it == pool.names.end()) {
+    return std::nullopt;
+  }
+  return NDFName(&*it);
+}
+
+const NDFName NDFName::list_item("ListItem");
+const NDFName NDFName::key("Key");
+const NDFName NDFName::value("Value");
+const NDFName NDFName::first("First");
+const NDFName NDFName::second("Second");
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// interned property name. all objects of a class repeat the same property
+// names, so every distinct name is stored once for the lifetime of the
+// program and NDFName only points to it. comparing and hashing NDFName
+// compares the pointers. looking up a name takes a shared lock and adding a
+// new one an exclusive lock, so hot paths keep NDFName around (e.g.
+// NDF::property_table) instead of converting strings.
+class NDFName {
+private:
+  const std::string *m_name;
+
+  static inline const std::string m_empty;
+  explicit NDFName(const std::string *name) : m_name(name) {}
+  static const std::string *intern(std::string_view name);
+
+public:
+  NDFName() : m_name(&m_empty) {}
+  // explicit, so strings aren't interned by accident, e.g. for lookups
+  explicit NDFName(std::string_view name) : m_name(intern(name)) {}
+  NDFName &operator=(std::string_view name) {
+    m_name = intern(name);
+    return *this;
+  }
+
+  // the interned name, without adding name if nothing interned it yet. a
+  // name that was never interned can't be the name of any property.
+  static std::optional<NDFName> find(std::string_view name);
+
+  // names of list, map and pair items
+  static const NDFName list_item;
+  static const NDFName key;
+  static const NDFName value;
+  static const NDFName first;
+  static const NDFName second;
+
+  const std::string &str() const { return *m_name; }
+  const char *c_str() const { return m_name->c_str(); }
+  size_t size() const { return m_name->size(); }
+  bool empty() const { return m_name->empty(); }
+  operator const std::string &() const { return *m_name; }
+  operator std::string_view() const { return *m_name; }
+
+  bool operator==(const NDFName &other) const {
+    return m_name == other.m_name;
+  }
+  bool operator==(std::string_view other) const { return *m_name == other; }
+
+  friend struct std::hash<NDFName>;
+};
+
+template <> struct std::hash<NDFName> {
+  size_t operator()(const NDFName &name) const {
+    return std::hash<const void *>()(name.m_name);
+  }
+};
@@ -0,0 +1,74 @@
+#include "ndf_path_trie.hpp"
+#include "ndfbin_reader.hpp"
+#include "ndfbin_writer.hpp"
+
+#include "spdlog/spdlog.h"
+
+#include <format>
+#include <stdexcept>
+
+void NDFPathTrie::read_ndfbin(NDFBinReader &reader) {
+  while (!reader.at_end()) {
+    read_ndfbin_node(reader, root);
+  }
+}
+
+void NDFPathTrie::read_ndfbin_node(NDFBinReader &reader, uint32_t parent) {
+  uint32_t tran_index = reader.read<uint32_t>();
+  uint32_t index = reader.read<uint32_t>();
+  uint32_t count = reader.read<uint32_t>();
+
+  uint32_t node = get_or_add_child(parent, tran_index);
+  nodes[node].index = index;
+
+  // the offsets of the children are relative to the start of the offset table
+  size_t begin_offset = reader.tell();
+  reader.require(size_t(count) * sizeof(uint32_t));
+  std::vector<uint32_t> offsets(count);
+  reader.read_into(offsets.data(), count);
+  for (uint32_t offset : offsets) {
+    if (offset != reader.tell() - begin_offset) {
+      throw std::runtime_error(
+          std::format("Invalid path node offset 0x{:02X} @0x{:02X}", offset,
+                      reader.tell()));
+    }
+    read_ndfbin_node(reader, node);
+  }
+}
+
+void NDFPathTrie::write_ndfbin(NDFBinWriter &writer) const {
+  // children are always added after their parent, so walking the nodes
+  // backwards computes the size of every subtree before its parent needs it
+  std::vector<uint32_t> sizes(nodes.size());
+  for (size_t node = nodes.size(); node-- > 0;) {
+    sizes[node] = 3 * sizeof(uint32_t) +
+                  nodes[node].children.size() * sizeof(uint32_t);
+    for (const auto &[tran_index, child] : nodes[node].children) {
+      sizes[node] += sizes[child];
+    }
+  }
+  for (const auto &[tran_index, child] : nodes[root].children) {
+    write_ndfbin_node(child, sizes, writer);
+  }
+}
+
+void NDFPathTrie::write_ndfbin_node(uint32_t node,
+                                    const std::vector<uint32_t> &sizes,
+                                    NDFBinWriter &writer) const {
+  const Node &n = nodes[node];
+  uint32_t count = n.children.size();
+  writer.write(n.tran_index);
+  writer.write(n.index);
+  writer.write(count);
+
+  // offsets are relative to the start of the offset table, the children
+  // follow the table in order
+  uint32_t offset = count * sizeof(uint32_t);
+  for (const auto &[tran_index, child] : n.children) {
+    writer.write(offset);
+    offset += sizes[child];
+  }
+  for (const auto &[tran_index, child] : n.children) {
+    write_ndfbin_node(child, sizes, writer);
+  }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class NDFBinReader;
+class NDFBinWriter;
+
+// interns '/' separated paths (imports and exports) as a trie, every node is
+// one path component stored as an index into a tran table. paths sharing a
+// prefix share the nodes of that prefix, which is also how IMPR and EXPR are
+// stored in ndfbin files.
+class NDFPathTrie {
+public:
+  static constexpr uint32_t no_index = 4294967295;
+
+  struct Node {
+    uint32_t tran_index = 0;
+    uint32_t parent = 0;
+    // import index or object index, no_index for inner nodes
+    uint32_t index = no_index;
+    // ordered by tran index, which is the order nodes are written in
+    std::map<uint32_t, uint32_t> children;
+  };
+
+private:
+  // nodes[0] is the root, it has no path component
+  std::vector<Node> nodes = {Node{}};
+
+  void read_ndfbin_node(NDFBinReader &reader, uint32_t parent);
+  void write_ndfbin_node(uint32_t node, const std::vector<uint32_t> &sizes,
+                         NDFBinWriter &writer) const;
+
+public:
+  static constexpr uint32_t root = 0;
+
+  const Node &get_node(uint32_t node) const { return nodes[node]; }
+  Node &get_node(uint32_t node) { return nodes[node]; }
+  size_t size() const { return nodes.size(); }
+
+  void clear() { nodes = {Node{}}; }
+
+  uint32_t get_or_add_child(uint32_t parent, uint32_t tran_index) {
+    auto it = nodes[parent].children.find(tran_index);
+    if (it != nodes[parent].children.end()) {
+      return it->second;
+    }
+    uint32_t ret = nodes.size();
+    nodes.push_back({tran_index, parent, no_index, {}});
+    nodes[parent].children.insert({tran_index, ret});
+    return ret;
+  }
+
+  // splits path at '/' and returns the node of the last component,
+  // get_tran maps a component to its tran index
+  template <typename GetTran>
+  uint32_t get_or_add_path(std::string_view path, GetTran &&get_tran) {
+    uint32_t node = root;
+    while (true) {
+      size_t pos = path.find('/');
+      node = get_or_add_child(node, get_tran(path.substr(0, pos)));
+      if (pos == std::string_view::npos) {
+        return node;
+      }
+      path.remove_prefix(pos + 1);
+    }
+  }
+
+  // joins the components from the root down to node with '/'
+  template <typename TranTable>
+  std::string get_path(uint32_t node, const TranTable &tran_table) const {
+    std::vector<uint32_t> components;
+    size_t length = 0;
+    for (; node != root; node = nodes[node].parent) {
+      uint32_t tran_index = nodes[node].tran_index;
+      components.push_back(tran_index);
+      length += std::string_view(tran_table[tran_index]).size() + 1;
+    }
+    std::string ret;
+    ret.reserve(length);
+    for (auto it = components.rbegin(); it != components.rend(); ++it) {
+      if (it != components.rbegin()) {
+        ret += '/';
+      }
+      ret += tran_table[*it];
+    }
+    return ret;
+  }
+
+  // calls fn(node, index) for every node with an index
+  template <typename Fn> void for_each_indexed(Fn &&fn) const {
+    for (uint32_t node = 0; node < nodes.size(); node++) {
+      if (nodes[node].index != no_index) {
+        fn(node, nodes[node].index);
+      }
+    }
+  }
+
+  // reads a IMPR/EXPR section
+  void read_ndfbin(NDFBinReader &reader);
+  // writes all nodes depth first, children ordered by tran index. the size
+  // of every subtree is computed first, so the offset tables are written
+  // directly instead of being patched afterwards
+  void write_ndfbin(NDFBinWriter &writer) const;
+};
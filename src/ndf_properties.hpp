@@ -1,12 +1,25 @@
 #pragma once
 
+#include "ndf_arena.hpp"
+#include "ndf_name.hpp"
+#include "ndf_value.hpp"
+
 #include "spdlog/spdlog.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <memory>
+#include <memory_resource>
+#include <new>
 #include <optional>
+#include <stdexcept>
 #include <pugixml.hpp>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 struct NDF;
@@ -42,7 +55,52 @@ enum NDFPropertyType : uint32_t {
   Hash = 0x25
 };
 
+// GUIDs and hashes are stored as raw bytes and only hex encoded (upper case,
+// no separators) for XML, the DB and as_string
+template <size_t N>
+std::string bytes_to_hex(const std::array<uint8_t, N> &bytes) {
+  constexpr char digits[] = "0123456789ABCDEF";
+  std::string ret(N * 2, '\0');
+  for (size_t i = 0; i < N; i++) {
+    ret[i * 2] = digits[bytes[i] >> 4];
+    ret[i * 2 + 1] = digits[bytes[i] & 0xF];
+  }
+  return ret;
+}
+
+template <size_t N> std::array<uint8_t, N> hex_to_bytes(std::string_view hex) {
+  if (hex.size() != N * 2) {
+    throw std::runtime_error(fmt::format(
+        "Invalid hex value {}, expected {} digits", hex, N * 2));
+  }
+  auto nibble = [](char c) -> int {
+    if (c >= '0' && c <= '9') {
+      return c - '0';
+    }
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f') {
+      return c - 'a' + 10;
+    }
+    return -1;
+  };
+  std::array<uint8_t, N> ret;
+  int invalid = 0;
+  for (size_t i = 0; i < N; i++) {
+    int high = nibble(hex[i * 2]);
+    int low = nibble(hex[i * 2 + 1]);
+    invalid |= high | low;
+    ret[i] = static_cast<uint8_t>((high << 4) | low);
+  }
+  if (invalid < 0) {
+    throw std::runtime_error(fmt::format("Invalid hex value {}", hex));
+  }
+  return ret;
+}
+
 class NDF_DB;
+class NDFBinReader;
+class NDFBinWriter;
+struct NDFBinVisitor;
 
 struct NDFProperty {
   // db stuff
@@ -56,27 +114,87 @@ struct NDFProperty {
   //
   uint32_t property_idx;
   uint32_t property_type;
-  std::string property_name;
+  NDFName property_name;
+  // number of NDFPropertyRef owning this property, see NDFObject::clone.
+  // copies start without owners
+  struct RefCount {
+    std::atomic<uint32_t> count = 0;
+    RefCount() = default;
+    RefCount(const RefCount &) {}
+    RefCount &operator=(const RefCount &) { return *this; }
+  } ref_count;
+
+private:
+  // set by operator new for the constructor of the allocated property
+  static inline thread_local bool s_new_in_arena = false;
+  // whether the property was allocated from an arena. copies and assignments
+  // keep their own, it lives in the padding after ref_count
+  struct AllocationFlag {
+    bool in_arena = std::exchange(s_new_in_arena, false);
+    AllocationFlag() = default;
+    AllocationFlag(const AllocationFlag &) {}
+    AllocationFlag &operator=(const AllocationFlag &) { return *this; }
+  } m_allocation;
+
+public:
   NDFProperty() = default;
   virtual ~NDFProperty() = default;
+
+  // properties are allocated from NDFArena::current() if there is one (while
+  // an NDF decodes ndfbin), the heap otherwise. the property remembers which
+  // one, deleting it only frees heap memory, arenas are freed as a whole.
+  static void *operator new(size_t size) {
+    NDFArena *arena = NDFArena::current();
+    void *ptr = arena ? arena->allocate(size) : ::operator new(size);
+    s_new_in_arena = arena != nullptr;
+    return ptr;
+  }
+  static void operator delete(NDFProperty *property, std::destroying_delete_t) {
+    bool in_arena = property->m_allocation.in_arena;
+    property->~NDFProperty();
+    if (!in_arena) {
+      ::operator delete(property);
+    }
+  }
+  // only used if a constructor throws, the arena is still current then
+  static void operator delete(void *ptr) {
+    if (!NDFArena::current()) {
+      ::operator delete(ptr);
+    }
+  }
   static std::unique_ptr<NDFProperty>
   get_property_from_ndftype(uint32_t ndf_type);
   static std::unique_ptr<NDFProperty>
   get_property_from_ndf_xml(uint32_t ndf_type, const pugi::xml_node &ndf_node);
   static std::unique_ptr<NDFProperty>
   get_property_from_ndf_db(uint32_t ndf_type, bool is_import_reference);
+  // reads and decodes a property value of the given ndf_type
   static std::unique_ptr<NDFProperty>
-  get_property_from_ndfbin(uint32_t ndf_type, std::istream &stream);
+  read_ndfbin(uint32_t ndf_type, NDF *root, NDFBinReader &reader);
+  static void skip_ndfbin(uint32_t ndf_type, NDFBinReader &reader);
+  // reads a property value and reports it to the visitor without creating
+  // property instances
+  static void visit_ndfbin(NDF *root, std::string_view name, uint32_t ndf_type,
+                           NDFBinReader &reader, NDFBinVisitor &visitor);
+  // reads a fixed size value, returns false without reading anything for
+  // WideString, List, Map and Pair
+  static bool read_ndfbin_value(uint32_t ndf_type, NDF *root,
+                                NDFBinReader &reader, NDFValue &value);
+  // writes the type and the payload of value
+  static void write_ndfbin_value(NDF *root, const NDFValue &value,
+                                 NDFBinWriter &writer);
+  // creates the property holding value, without a name
+  static std::unique_ptr<NDFProperty> from_value(const NDFValue &value);
   virtual void to_ndf_xml(pugi::xml_node &) const {
     throw std::runtime_error("Not implemented");
   }
   virtual void from_ndf_xml(const pugi::xml_node &) {
     throw std::runtime_error("Not implemented");
   }
-  virtual void from_ndfbin(NDF *, std::istream &) {
+  virtual void from_ndfbin(NDF *, NDFBinReader &) {
     throw std::runtime_error("Not implemented");
   }
-  virtual void to_ndfbin(NDF *, std::ostream &) const {
+  virtual void to_ndfbin(NDF *, NDFBinWriter &) const {
     throw std::runtime_error("Not implemented");
   }
   virtual bool to_ndf_db(NDF_DB *) {
@@ -90,8 +208,8 @@ struct NDFProperty {
   virtual bool is_list() const { return false; }
   virtual bool is_map() const { return false; }
   virtual bool is_pair() const { return false; }
-  virtual std::unique_ptr<NDFProperty> get_copy() = 0;
-  virtual std::string as_string() = 0;
+  virtual std::unique_ptr<NDFProperty> get_copy() const = 0;
+  virtual std::string as_string() const = 0;
 
   // used by ndf_db
   int get_db_property_value(NDF_DB *db, int property_id);
@@ -100,6 +218,77 @@ struct NDFProperty {
   std::optional<int> add_db_property(NDF_DB *db) const;
 };
 
+// reference counted owner of the properties of an object. clones of an
+// object share their properties until one of them changes, see
+// NDFObject::clone. only the properties of objects are shared, the items of
+// lists, maps and pairs are owned by their container. the count is atomic,
+// references to a shared property are copied and dropped on the threads
+// decoding or saving ndfbin. changing the property itself isn't thread safe.
+class NDFPropertyRef {
+private:
+  NDFProperty *m_property = nullptr;
+
+  void release() {
+    if (m_property && m_property->ref_count.count.fetch_sub(
+                          1, std::memory_order_acq_rel) == 1) {
+      delete m_property;
+    }
+    m_property = nullptr;
+  }
+
+public:
+  NDFPropertyRef() = default;
+  template <typename T>
+  NDFPropertyRef(std::unique_ptr<T> property) : m_property(property.release()) {
+    if (m_property) {
+      m_property->ref_count.count.store(1, std::memory_order_relaxed);
+    }
+  }
+  NDFPropertyRef(const NDFPropertyRef &other) : m_property(other.m_property) {
+    if (m_property) {
+      m_property->ref_count.count.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  NDFPropertyRef(NDFPropertyRef &&other) noexcept
+      : m_property(std::exchange(other.m_property, nullptr)) {}
+  NDFPropertyRef &operator=(NDFPropertyRef other) noexcept {
+    std::swap(m_property, other.m_property);
+    return *this;
+  }
+  ~NDFPropertyRef() { release(); }
+
+  // read only, the property may be shared. changes go through
+  // NDFObject::edit_property, which copies it first
+  const NDFProperty *get() const { return m_property; }
+  const NDFProperty *operator->() const { return m_property; }
+  const NDFProperty &operator*() const { return *m_property; }
+  explicit operator bool() const { return m_property != nullptr; }
+  bool operator==(const NDFPropertyRef &other) const {
+    return m_property == other.m_property;
+  }
+  bool is_shared() const {
+    return m_property &&
+           m_property->ref_count.count.load(std::memory_order_acquire) > 1;
+  }
+  // replaces a shared property with a copy only owned by this reference
+  void make_unique() {
+    if (is_shared()) {
+      *this = NDFPropertyRef(m_property->get_copy());
+    }
+  }
+
+private:
+  // the property after make_unique, only for NDFObject::edit_property and
+  // for setting the db ids when inserting objects into the db
+  NDFProperty &edit() {
+    make_unique();
+    return *m_property;
+  }
+  friend struct NDFObject;
+  friend struct NDF;
+  friend class NDF_DB;
+};
+
 struct NDFPropertyBool : NDFProperty {
   bool value;
   NDFPropertyBool() { property_type = NDFPropertyType::Bool; }
@@ -107,17 +296,17 @@ struct NDFPropertyBool : NDFProperty {
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
-  void to_ndfbin(NDF *, std::ostream &stream) const override;
+  void from_ndfbin(NDF *, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, bool new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyBool>(*this);
   }
-  std::string as_string() override { return value ? "true" : "false"; }
+  std::string as_string() const override { return value ? "true" : "false"; }
 };
 
 struct NDFPropertyUInt8 : NDFProperty {
@@ -126,17 +315,17 @@ struct NDFPropertyUInt8 : NDFProperty {
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
-  void to_ndfbin(NDF *, std::ostream &stream) const override;
+  void from_ndfbin(NDF *, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, uint8_t new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyUInt8>(*this);
   }
-  std::string as_string() override { return std::to_string(value); }
+  std::string as_string() const override { return std::to_string(value); }
 };
 
 struct NDFPropertyInt16 : NDFProperty {
@@ -146,17 +335,17 @@ struct NDFPropertyInt16 : NDFProperty {
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
-  void to_ndfbin(NDF *, std::ostream &stream) const override;
+  void from_ndfbin(NDF *, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, int16_t new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyInt16>(*this);
   }
-  std::string as_string() override { return std::to_string(value); }
+  std::string as_string() const override { return std::to_string(value); }
 };
 
 struct NDFPropertyUInt16 : NDFProperty {
@@ -166,17 +355,17 @@ struct NDFPropertyUInt16 : NDFProperty {
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
-  void to_ndfbin(NDF *, std::ostream &stream) const override;
+  void from_ndfbin(NDF *, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, uint16_t new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyUInt16>(*this);
   }
-  std::string as_string() override { return std::to_string(value); }
+  std::string as_string() const override { return std::to_string(value); }
 };
 
 struct NDFPropertyInt32 : NDFProperty {
@@ -186,17 +375,17 @@ struct NDFPropertyInt32 : NDFProperty {
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
-  void to_ndfbin(NDF *, std::ostream &stream) const override;
+  void from_ndfbin(NDF *, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, int32_t new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyInt32>(*this);
   }
-  std::string as_string() override { return std::to_string(value); }
+  std::string as_string() const override { return std::to_string(value); }
 };
 
 struct NDFPropertyUInt32 : NDFProperty {
@@ -206,17 +395,17 @@ struct NDFPropertyUInt32 : NDFProperty {
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
-  void to_ndfbin(NDF *, std::ostream &stream) const override;
+  void from_ndfbin(NDF *, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, uint32_t new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyUInt32>(*this);
   }
-  std::string as_string() override { return std::to_string(value); }
+  std::string as_string() const override { return std::to_string(value); }
 };
 
 struct NDFPropertyFloat32 : NDFProperty {
@@ -226,17 +415,17 @@ struct NDFPropertyFloat32 : NDFProperty {
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
-  void to_ndfbin(NDF *, std::ostream &stream) const override;
+  void from_ndfbin(NDF *, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, float new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyFloat32>(*this);
   }
-  std::string as_string() override { return std::to_string(value); }
+  std::string as_string() const override { return std::to_string(value); }
 };
 
 struct NDFPropertyFloat64 : NDFProperty {
@@ -246,17 +435,17 @@ struct NDFPropertyFloat64 : NDFProperty {
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
-  void to_ndfbin(NDF *, std::ostream &stream) const override;
+  void from_ndfbin(NDF *, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, double new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyFloat64>(*this);
   }
-  std::string as_string() override { return std::to_string(value); }
+  std::string as_string() const override { return std::to_string(value); }
 };
 
 struct NDFPropertyString : NDFProperty {
@@ -266,17 +455,17 @@ struct NDFPropertyString : NDFProperty {
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *root, std::istream &stream) override;
-  void to_ndfbin(NDF *root, std::ostream &stream) const override;
+  void from_ndfbin(NDF *root, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *root, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, std::string new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyString>(*this);
   }
-  std::string as_string() override { return value; }
+  std::string as_string() const override { return value; }
 };
 
 struct NDFPropertyWideString : NDFProperty {
@@ -285,17 +474,17 @@ struct NDFPropertyWideString : NDFProperty {
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *root, std::istream &stream) override;
-  void to_ndfbin(NDF *root, std::ostream &stream) const override;
+  void from_ndfbin(NDF *root, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *root, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, std::string new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyWideString>(*this);
   }
-  std::string as_string() override { return value; }
+  std::string as_string() const override { return value; }
 };
 
 struct NDFPropertyF32_vec2 : NDFProperty {
@@ -306,18 +495,20 @@ struct NDFPropertyF32_vec2 : NDFProperty {
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
-  void to_ndfbin(NDF *, std::ostream &stream) const override;
+  void from_ndfbin(NDF *, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, float new_value_x,
                     float new_value_y);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyF32_vec2>(*this);
   }
-  std::string as_string() override { return fmt::format("({}, {})", x, y); }
+  std::string as_string() const override {
+    return fmt::format("({}, {})", x, y);
+  }
 };
 
 struct NDFPropertyF32_vec3 : NDFProperty {
@@ -329,18 +520,18 @@ struct NDFPropertyF32_vec3 : NDFProperty {
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
-  void to_ndfbin(NDF *, std::ostream &stream) const override;
+  void from_ndfbin(NDF *, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, float new_value_x,
                     float new_value_y, float new_value_z);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyF32_vec3>(*this);
   }
-  std::string as_string() override {
+  std::string as_string() const override {
     return fmt::format("({}, {}, {})", x, y, z);
   }
 };
@@ -355,18 +546,18 @@ struct NDFPropertyF32_vec4 : NDFProperty {
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
-  void to_ndfbin(NDF *, std::ostream &stream) const override;
+  void from_ndfbin(NDF *, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, float new_value_x,
                     float new_value_y, float new_value_z, float new_value_w);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyF32_vec4>(*this);
   }
-  std::string as_string() override {
+  std::string as_string() const override {
     return fmt::format("({}, {}, {}, {})", x, y, z, w);
   }
 };
@@ -381,8 +572,8 @@ struct NDFPropertyColor : NDFProperty {
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
-  void to_ndfbin(NDF *, std::ostream &stream) const override;
+  void from_ndfbin(NDF *, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
@@ -390,10 +581,10 @@ struct NDFPropertyColor : NDFProperty {
                     uint8_t new_value_g, uint8_t new_value_b,
                     uint8_t new_value_a);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyColor>(*this);
   }
-  std::string as_string() override {
+  std::string as_string() const override {
     return fmt::format("({}, {}, {}, {})", r, g, b, a);
   }
 };
@@ -406,18 +597,20 @@ struct NDFPropertyS32_vec2 : NDFProperty {
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
-  void to_ndfbin(NDF *, std::ostream &stream) const override;
+  void from_ndfbin(NDF *, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, int32_t new_value_x,
                     int32_t new_value_y);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyS32_vec2>(*this);
   }
-  std::string as_string() override { return fmt::format("({}, {})", x, y); }
+  std::string as_string() const override {
+    return fmt::format("({}, {})", x, y);
+  }
 };
 
 struct NDFPropertyS32_vec3 : NDFProperty {
@@ -429,18 +622,18 @@ struct NDFPropertyS32_vec3 : NDFProperty {
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
-  void to_ndfbin(NDF *, std::ostream &stream) const override;
+  void from_ndfbin(NDF *, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, int32_t new_value_x,
                     int32_t new_value_y, int32_t new_value_z);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyS32_vec3>(*this);
   }
-  std::string as_string() override {
+  std::string as_string() const override {
     return fmt::format("({}, {}, {})", x, y, z);
   }
 };
@@ -448,6 +641,10 @@ struct NDFPropertyS32_vec3 : NDFProperty {
 enum ReferenceType { Import = 2863311530, Object = 3149642683 };
 
 struct NDFPropertyObjectReference : NDFProperty {
+  static constexpr uint32_t no_object = 4294967295;
+  // references loaded from ndfbin only store the index of the object, the
+  // name is only needed for references created by name (XML, DB, generator)
+  uint32_t object_index = no_object;
   std::string object_name;
   NDFPropertyObjectReference() {
     property_type = NDFPropertyType::ObjectReference;
@@ -458,17 +655,24 @@ struct NDFPropertyObjectReference : NDFProperty {
 
   bool is_object_reference() const override { return true; }
 
-  void from_ndfbin(NDF *root, std::istream &stream) override;
-  void to_ndfbin(NDF *root, std::ostream &stream) const override;
+  void from_ndfbin(NDF *root, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *root, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, std::string new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyObjectReference>(*this);
   }
-  std::string as_string() override { return object_name; }
+  // objects loaded from ndfbin are named after their index
+  std::string get_object_name() const {
+    if (object_index == no_object) {
+      return object_name;
+    }
+    return "Object_" + std::to_string(object_index);
+  }
+  std::string as_string() const override { return get_object_name(); }
 };
 
 struct NDFPropertyImportReference : NDFProperty {
@@ -482,100 +686,200 @@ struct NDFPropertyImportReference : NDFProperty {
 
   bool is_import_reference() const override { return true; }
 
-  void from_ndfbin(NDF *root, std::istream &stream) override;
-  void to_ndfbin(NDF *root, std::ostream &stream) const override;
+  void from_ndfbin(NDF *root, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *root, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, std::string new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyImportReference>(*this);
   }
-  std::string as_string() override { return import_name; }
+  std::string as_string() const override { return import_name; }
 };
 
 struct NDFPropertyList : NDFProperty {
-  std::vector<std::unique_ptr<NDFProperty>> values;
+private:
+  // the items as properties, empty while the list is packed
+  std::vector<std::unique_ptr<NDFProperty>> m_values;
+
+  void require_unpacked() const {
+    if (is_packed()) {
+      throw std::logic_error(fmt::format(
+          "List {} is packed, unpack() it before reading values()",
+          property_name.str()));
+    }
+  }
+
+public:
+  // lists only containing Int32/UInt32/Float32/F32_vec3 items are kept packed
+  // when loaded from ndfbin: packed_type is the item type and packed holds
+  // the raw 32 bit words of all items. other lists of fixed size items are
+  // kept as packed_values.
+  // both live in the current arena when the list is created, see NDFArena.
+  uint32_t packed_type = 0;
+  std::pmr::vector<uint32_t> packed{NDFArena::current_resource()};
+  std::pmr::vector<NDFValue> packed_values{NDFArena::current_resource()};
   NDFPropertyList() { property_type = NDFPropertyType::List; }
 
+  bool is_packed() const { return !packed.empty() || !packed_values.empty(); }
+  size_t size() const;
+  // the item properties for changing them, packed lists are unpacked first
+  std::vector<std::unique_ptr<NDFProperty>> &values() {
+    unpack();
+    return m_values;
+  }
+  // read only item properties, throws std::logic_error for packed lists.
+  // size(), ndf_list_item and NDFListView read both representations
+  const std::vector<std::unique_ptr<NDFProperty>> &values() const {
+    require_unpacked();
+    return m_values;
+  }
+  // creates properties for all items, packed or not
+  std::vector<std::unique_ptr<NDFProperty>> unpacked_values() const;
+  void unpack() {
+    if (is_packed()) {
+      m_values = unpacked_values();
+      packed.clear();
+      packed_type = 0;
+      packed_values.clear();
+    }
+  }
+
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
   bool is_list() const override { return true; }
 
-  void from_ndfbin(NDF *, std::istream &) override;
-  void to_ndfbin(NDF *, std::ostream &) const override;
+  void from_ndfbin(NDF *, NDFBinReader &) override;
+  void to_ndfbin(NDF *, NDFBinWriter &) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     auto ret = std::make_unique<NDFPropertyList>();
-    for (auto const &value : values) {
-      ret->values.push_back(value->get_copy());
-      ret->property_name = property_name;
-      ret->property_idx = property_idx;
-      ret->property_type = property_type;
+    ret->property_name = property_name;
+    ret->property_idx = property_idx;
+    ret->property_type = property_type;
+    ret->packed_type = packed_type;
+    ret->packed = packed;
+    ret->packed_values = packed_values;
+    // the copy may outlive the tables the views point into
+    if (std::ranges::any_of(packed_values, is_ndf_value_view)) {
+      ret->unpack();
+    }
+    for (auto const &value : m_values) {
+      ret->m_values.push_back(value->get_copy());
     }
     return ret;
   }
-  std::string as_string() override {
-    return "size " + std::to_string(values.size());
+  std::string as_string() const override {
+    return "size " + std::to_string(size());
   }
 };
 
 struct NDFPropertyMap : NDFProperty {
-  std::vector<
-      std::pair<std::unique_ptr<NDFProperty>, std::unique_ptr<NDFProperty>>>
-      values;
+  using Entries = std::vector<
+      std::pair<std::unique_ptr<NDFProperty>, std::unique_ptr<NDFProperty>>>;
+
+private:
+  // the entries as properties, empty while the map is packed
+  Entries m_values;
+
+  void require_unpacked() const {
+    if (is_packed()) {
+      throw std::logic_error(fmt::format(
+          "Map {} is packed, unpack() it before reading values()",
+          property_name.str()));
+    }
+  }
+
+public:
+  // maps of fixed size keys and values loaded from ndfbin keep them as
+  // packed_values
+  std::pmr::vector<std::pair<NDFValue, NDFValue>> packed_values{
+      NDFArena::current_resource()};
   NDFPropertyMap() { property_type = NDFPropertyType::Map; }
 
+  bool is_packed() const { return !packed_values.empty(); }
+  size_t size() const {
+    return is_packed() ? packed_values.size() : m_values.size();
+  }
+  // the key and value properties for changing them, packed maps are
+  // unpacked first
+  Entries &values() {
+    unpack();
+    return m_values;
+  }
+  // read only key and value properties, throws std::logic_error for packed
+  // maps, see NDFPropertyList::values
+  const Entries &values() const {
+    require_unpacked();
+    return m_values;
+  }
+  // creates key and value properties for all entries, packed or not
+  Entries unpacked_values() const;
+  void unpack() {
+    if (is_packed()) {
+      m_values = unpacked_values();
+      packed_values.clear();
+    }
+  }
+
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
   bool is_map() const override { return true; }
 
-  void from_ndfbin(NDF *, std::istream &) override;
-  void to_ndfbin(NDF *, std::ostream &) const override;
+  void from_ndfbin(NDF *, NDFBinReader &) override;
+  void to_ndfbin(NDF *, NDFBinWriter &) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     auto ret = std::make_unique<NDFPropertyMap>();
-    for (auto const &[key, value] : values) {
-      ret->values.push_back({key->get_copy(), value->get_copy()});
+    for (auto const &[key, value] : m_values) {
+      ret->m_values.push_back({key->get_copy(), value->get_copy()});
+    }
+    ret->packed_values = packed_values;
+    // see NDFPropertyList::get_copy
+    if (std::ranges::any_of(packed_values, [](const auto &item) {
+          return is_ndf_value_view(item.first) ||
+                 is_ndf_value_view(item.second);
+        })) {
+      ret->unpack();
     }
     ret->property_name = property_name;
     ret->property_idx = property_idx;
     ret->property_type = property_type;
     return ret;
   }
-  std::string as_string() override {
-    return "size " + std::to_string(values.size());
+  std::string as_string() const override {
+    return "size " + std::to_string(size());
   }
 };
 
-// FIXME: error checking for GUIDs?
 struct NDFPropertyGUID : NDFProperty {
-  std::string guid;
+  std::array<uint8_t, 16> guid{};
   NDFPropertyGUID() { property_type = NDFPropertyType::NDFGUID; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
-  void to_ndfbin(NDF *, std::ostream &stream) const override;
+  void from_ndfbin(NDF *, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, std::string new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyGUID>(*this);
   }
-  std::string as_string() override { return guid; }
+  std::string as_string() const override { return bytes_to_hex(guid); }
 };
 
 struct NDFPropertyPathReference : NDFProperty {
@@ -585,22 +889,21 @@ struct NDFPropertyPathReference : NDFProperty {
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &) override;
-  void to_ndfbin(NDF *, std::ostream &) const override;
+  void from_ndfbin(NDF *, NDFBinReader &) override;
+  void to_ndfbin(NDF *, NDFBinWriter &) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, std::string new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyPathReference>(*this);
   }
-  std::string as_string() override { return path; }
+  std::string as_string() const override { return path; }
 };
 
-// FIXME: error checking for hashes?
 struct NDFPropertyLocalisationHash : NDFProperty {
-  std::string hash;
+  std::array<uint8_t, 8> hash{};
   NDFPropertyLocalisationHash() {
     property_type = NDFPropertyType::LocalisationHash;
   }
@@ -608,66 +911,93 @@ struct NDFPropertyLocalisationHash : NDFProperty {
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
-  void to_ndfbin(NDF *, std::ostream &stream) const override;
+  void from_ndfbin(NDF *, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, std::string new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyLocalisationHash>(*this);
   }
-  std::string as_string() override { return hash; }
+  std::string as_string() const override { return bytes_to_hex(hash); }
 };
 
-// FIXME: error checking for hashes?
 struct NDFPropertyHash : NDFProperty {
-  std::string hash;
+  std::array<uint8_t, 16> hash{};
   NDFPropertyHash() { property_type = NDFPropertyType::Hash; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
-  void to_ndfbin(NDF *, std::ostream &stream) const override;
+  void from_ndfbin(NDF *, NDFBinReader &reader) override;
+  void to_ndfbin(NDF *, NDFBinWriter &writer) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
   bool change_value(NDF_DB *db, int property_id, std::string new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     return std::make_unique<NDFPropertyHash>(*this);
   }
-  std::string as_string() override { return hash; }
+  std::string as_string() const override { return bytes_to_hex(hash); }
 };
 
 struct NDFPropertyPair : NDFProperty {
   std::unique_ptr<NDFProperty> first;
   std::unique_ptr<NDFProperty> second;
+  // pairs of fixed size values loaded from ndfbin keep them here, first and
+  // second stay empty until unpack()
+  std::optional<std::pair<NDFValue, NDFValue>> packed_values;
   NDFPropertyPair() { property_type = NDFPropertyType::Pair; }
 
+  bool is_packed() const { return packed_values.has_value(); }
+  // creates the first and second properties of a packed pair
+  std::pair<std::unique_ptr<NDFProperty>, std::unique_ptr<NDFProperty>>
+  unpacked_values() const;
+  void unpack() {
+    if (is_packed()) {
+      std::tie(first, second) = unpacked_values();
+      packed_values.reset();
+    }
+  }
+
   void to_ndf_xml(pugi::xml_node &node) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
   bool is_pair() const override { return true; }
 
-  void from_ndfbin(NDF *, std::istream &) override;
-  void to_ndfbin(NDF *, std::ostream &) const override;
+  void from_ndfbin(NDF *, NDFBinReader &) override;
+  void to_ndfbin(NDF *, NDFBinWriter &) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
   bool to_ndf_db(NDF_DB *db) override;
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  std::unique_ptr<NDFProperty> get_copy() const override {
     auto ret = std::make_unique<NDFPropertyPair>();
-    ret->first = first->get_copy();
-    ret->second = second->get_copy();
+    if (is_packed()) {
+      ret->packed_values = packed_values;
+      // see NDFPropertyList::get_copy
+      if (is_ndf_value_view(packed_values->first) ||
+          is_ndf_value_view(packed_values->second)) {
+        ret->unpack();
+      }
+    } else {
+      ret->first = first->get_copy();
+      ret->second = second->get_copy();
+    }
     ret->property_name = property_name;
     ret->property_idx = property_idx;
     ret->property_type = property_type;
     return ret;
   }
-  std::string as_string() override {
+  std::string as_string() const override {
+    if (is_packed()) {
+      return fmt::format("({}, {})",
+                         from_value(packed_values->first)->as_string(),
+                         from_value(packed_values->second)->as_string());
+    }
     return fmt::format("({}, {})", first->as_string(), second->as_string());
   }
 };
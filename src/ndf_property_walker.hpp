@@ -0,0 +1,107 @@
+#pragma once
+
+#include "ndf_accessors.hpp"
+#include "ndf_properties.hpp"
+#include "ndf_value.hpp"
+
+#include <memory>
+#include <type_traits>
+
+// depth first traversal of a property tree, dispatched with ndf_visit on
+// property_type and on the Derived type at compile time, so there is no
+// virtual call per node. Derived hides the hooks it needs, the defaults do
+// nothing. containers are walked in ndfbin order (list items, map key then
+// value, pair first then second) in whatever representation they have:
+// - begin_property(p) for every property, containers included, before
+//   anything else of it
+// - leaf(const P &p) for every property that isn't a list, map or pair, with
+//   P the property struct. overloading it for some structs only needs
+//   `using NDFPropertyWalker::leaf;` to keep the default for the others
+// - value(v) for every item kept packed as NDFValue
+// - packed_words(list) for lists kept as raw words, the default reports every
+//   item to value()
+// - null_item() for missing map or pair items
+// - begin_list/begin_map/begin_pair return false to skip the items, the end_
+//   hooks are called either way
+// walk(property) may be called for any number of trees, e.g. all properties
+// of all objects.
+template <typename Derived> class NDFPropertyWalker {
+private:
+  Derived &derived() { return static_cast<Derived &>(*this); }
+
+  void walk_item(const std::unique_ptr<NDFProperty> &item) {
+    if (item) {
+      walk(*item);
+    } else {
+      derived().null_item();
+    }
+  }
+
+  template <typename P> void walk_node(const P &property) {
+    derived().begin_property(property);
+    if constexpr (std::is_same_v<P, NDFPropertyList>) {
+      if (derived().begin_list(property)) {
+        if (!property.packed.empty()) {
+          derived().packed_words(property);
+        }
+        for (const auto &value : property.packed_values) {
+          derived().value(value);
+        }
+        if (!property.is_packed()) {
+          for (const auto &item : property.values()) {
+            walk_item(item);
+          }
+        }
+      }
+      derived().end_list(property);
+    } else if constexpr (std::is_same_v<P, NDFPropertyMap>) {
+      if (derived().begin_map(property)) {
+        for (const auto &[key, value] : property.packed_values) {
+          derived().value(key);
+          derived().value(value);
+        }
+        if (!property.is_packed()) {
+          for (const auto &[key, value] : property.values()) {
+            walk_item(key);
+            walk_item(value);
+          }
+        }
+      }
+      derived().end_map(property);
+    } else if constexpr (std::is_same_v<P, NDFPropertyPair>) {
+      if (derived().begin_pair(property)) {
+        if (property.is_packed()) {
+          derived().value(property.packed_values->first);
+          derived().value(property.packed_values->second);
+        } else {
+          walk_item(property.first);
+          walk_item(property.second);
+        }
+      }
+      derived().end_pair(property);
+    } else {
+      derived().leaf(property);
+    }
+  }
+
+public:
+  void walk(const NDFProperty &property) {
+    ndf_visit(property, [this](const auto &p) { walk_node(p); });
+  }
+
+  void begin_property(const NDFProperty &) {}
+  template <typename P> void leaf(const P &) {}
+  void value(const NDFValue &) {}
+  void packed_words(const NDFPropertyList &list) {
+    for (size_t i = 0; i < list.size(); i++) {
+      derived().value(ndf_list_item(list, i).value);
+    }
+  }
+  void null_item() {}
+  bool begin_list(const NDFPropertyList &) { return true; }
+  void end_list(const NDFPropertyList &) {}
+  bool begin_map(const NDFPropertyMap &) { return true; }
+  void end_map(const NDFPropertyMap &) {}
+  bool begin_pair(const NDFPropertyPair &) { return true; }
+  void end_pair(const NDFPropertyPair &) {}
+};
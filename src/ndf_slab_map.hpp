@@ -0,0 +1,272 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// insertion ordered map from names to values, used for the objects of a NDF.
+// values live in fixed size slabs and are never moved, so references stay
+// valid while more values are added, and every value has a dense index (its
+// position in insertion order, which is also the ndfbin object index).
+// values can only be appended, so the index is the insertion order.
+// the name -> index hash uses open addressing like NDFSymbolTable and can be
+// read from multiple threads. values appended with append_unnamed have an
+// empty name and aren't in the hash, they can only be reached by index.
+// the interface follows tsl::ordered_map: iterators dereference to
+// std::pair<const std::string, T> and nth(index) is O(1).
+template <typename T, size_t SlabSize = 256> class NDFSlabMap {
+public:
+  static constexpr uint32_t no_index = 4294967295;
+  using key_type = std::string;
+  using mapped_type = T;
+  using value_type = std::pair<const std::string, T>;
+  using size_type = size_t;
+
+private:
+  struct Bucket {
+    uint32_t hash = 0;
+    uint32_t index = no_index;
+  };
+  struct Slab {
+    alignas(value_type) std::byte data[sizeof(value_type) * SlabSize];
+    value_type *get(size_t i) {
+      return std::launder(reinterpret_cast<value_type *>(data) + i);
+    }
+  };
+  std::vector<std::unique_ptr<Slab>> m_slabs;
+  size_t m_size = 0;
+  // number of values in m_buckets
+  size_t m_named = 0;
+  // power of two size, kept at most half full
+  std::vector<Bucket> m_buckets;
+
+  static uint32_t hash(std::string_view str) {
+    return static_cast<uint32_t>(std::hash<std::string_view>{}(str));
+  }
+
+  value_type &slot(size_t index) const {
+    return *m_slabs[index / SlabSize]->get(index % SlabSize);
+  }
+
+  // returns the bucket of name or the empty bucket it would be inserted into
+  size_t find_bucket(std::string_view name, uint32_t h) const {
+    size_t mask = m_buckets.size() - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+      const Bucket &bucket = m_buckets[i];
+      if (bucket.index == no_index ||
+          (bucket.hash == h && slot(bucket.index).first == name)) {
+        return i;
+      }
+    }
+  }
+
+  void rehash(size_t bucket_count) {
+    std::vector<Bucket> buckets(bucket_count);
+    std::swap(buckets, m_buckets);
+    size_t mask = m_buckets.size() - 1;
+    for (const Bucket &bucket : buckets) {
+      if (bucket.index == no_index) {
+        continue;
+      }
+      size_t i = bucket.hash & mask;
+      while (m_buckets[i].index != no_index) {
+        i = (i + 1) & mask;
+      }
+      m_buckets[i] = bucket;
+    }
+  }
+
+  void destroy() {
+    for (size_t i = 0; i < m_size; i++) {
+      slot(i).~value_type();
+    }
+    m_size = 0;
+    m_named = 0;
+  }
+
+  template <typename... Args>
+  void construct_back(std::string_view name, Args &&...args) {
+    if (m_size == m_slabs.size() * SlabSize) {
+      m_slabs.push_back(std::make_unique_for_overwrite<Slab>());
+    }
+    new (m_slabs.back()->get(m_size % SlabSize))
+        value_type(std::piecewise_construct, std::forward_as_tuple(name),
+                   std::forward_as_tuple(std::forward<Args>(args)...));
+    m_size++;
+  }
+
+public:
+  template <bool Const> class Iterator {
+  private:
+    using Map = std::conditional_t<Const, const NDFSlabMap, NDFSlabMap>;
+    using Value = std::conditional_t<Const, const NDFSlabMap::value_type,
+                                     NDFSlabMap::value_type>;
+    Map *m_map = nullptr;
+    size_t m_index = 0;
+
+  public:
+    using iterator_concept = std::forward_iterator_tag;
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = NDFSlabMap::value_type;
+    using difference_type = std::ptrdiff_t;
+    using reference = Value &;
+    using pointer = Value *;
+
+    Iterator() = default;
+    Iterator(Map *map, size_t index) : m_map(map), m_index(index) {}
+    // iterator -> const_iterator, a template so it isn't a copy constructor
+    template <bool OtherConst>
+      requires(Const && !OtherConst)
+    Iterator(const Iterator<OtherConst> &other)
+        : m_map(other.m_map), m_index(other.m_index) {}
+
+    reference operator*() const { return m_map->slot(m_index); }
+    pointer operator->() const { return &m_map->slot(m_index); }
+    const std::string &key() const { return (**this).first; }
+    auto &value() const { return (**this).second; }
+    // dense index of the value, see NDFSlabMap::index_of
+    size_t index() const { return m_index; }
+
+    Iterator &operator++() {
+      m_index++;
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator ret = *this;
+      m_index++;
+      return ret;
+    }
+    bool operator==(const Iterator &other) const {
+      return m_index == other.m_index;
+    }
+
+    friend class Iterator<!Const>;
+  };
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  NDFSlabMap() = default;
+  NDFSlabMap(const NDFSlabMap &) = delete;
+  NDFSlabMap &operator=(const NDFSlabMap &) = delete;
+  NDFSlabMap(NDFSlabMap &&other) noexcept
+      : m_slabs(std::move(other.m_slabs)),
+        m_size(std::exchange(other.m_size, 0)),
+        m_named(std::exchange(other.m_named, 0)),
+        m_buckets(std::move(other.m_buckets)) {}
+  NDFSlabMap &operator=(NDFSlabMap &&other) noexcept {
+    std::swap(m_slabs, other.m_slabs);
+    std::swap(m_size, other.m_size);
+    std::swap(m_named, other.m_named);
+    std::swap(m_buckets, other.m_buckets);
+    return *this;
+  }
+  ~NDFSlabMap() { destroy(); }
+
+  iterator begin() { return {this, 0}; }
+  iterator end() { return {this, m_size}; }
+  const_iterator begin() const { return {this, 0}; }
+  const_iterator end() const { return {this, m_size}; }
+  iterator nth(size_t index) { return {this, index}; }
+  const_iterator nth(size_t index) const { return {this, index}; }
+
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  void reserve(size_t count) {
+    m_slabs.reserve((count + SlabSize - 1) / SlabSize);
+    size_t bucket_count = std::max<size_t>(16, m_buckets.size());
+    while (bucket_count < count * 2) {
+      bucket_count *= 2;
+    }
+    if (bucket_count != m_buckets.size()) {
+      rehash(bucket_count);
+    }
+  }
+
+  // index of the value, no_index if there is none or it is unnamed
+  uint32_t index_of(std::string_view name) const {
+    if (m_buckets.empty()) {
+      return no_index;
+    }
+    return m_buckets[find_bucket(name, hash(name))].index;
+  }
+  iterator find(std::string_view name) {
+    uint32_t index = index_of(name);
+    return index == no_index ? end() : nth(index);
+  }
+  const_iterator find(std::string_view name) const {
+    uint32_t index = index_of(name);
+    return index == no_index ? end() : nth(index);
+  }
+  bool contains(std::string_view name) const {
+    return index_of(name) != no_index;
+  }
+
+  // the value with the given index, see index_of
+  T &get(size_t index) { return slot(index).second; }
+  const T &get(size_t index) const { return slot(index).second; }
+
+  // throws std::out_of_range if there is no such value
+  T &at(std::string_view name) {
+    uint32_t index = index_of(name);
+    if (index == no_index) {
+      throw std::out_of_range(std::format("Unknown object {}", name));
+    }
+    return get(index);
+  }
+  const T &at(std::string_view name) const {
+    return const_cast<NDFSlabMap *>(this)->at(name);
+  }
+
+  // appends the value if there is no value with the same name yet, doesn't
+  // touch the values already in the map
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(std::string_view name,
+                                        Args &&...args) {
+    if ((m_named + 1) * 2 > m_buckets.size()) {
+      rehash(std::max<size_t>(16, m_buckets.size() * 2));
+    }
+    uint32_t h = hash(name);
+    Bucket &bucket = m_buckets[find_bucket(name, h)];
+    if (bucket.index != no_index) {
+      return {nth(bucket.index), false};
+    }
+    construct_back(name, std::forward<Args>(args)...);
+    bucket = {h, static_cast<uint32_t>(m_size - 1)};
+    m_named++;
+    return {nth(bucket.index), true};
+  }
+  // appends a value with an empty name without hashing it, the caller makes
+  // sure it can be told apart from the named values by index
+  template <typename... Args> iterator append_unnamed(Args &&...args) {
+    construct_back({}, std::forward<Args>(args)...);
+    return nth(m_size - 1);
+  }
+  std::pair<iterator, bool> emplace(std::string_view name, T value) {
+    return try_emplace(name, std::move(value));
+  }
+  std::pair<iterator, bool> insert(value_type &&value) {
+    return try_emplace(value.first, std::move(value.second));
+  }
+  T &operator[](std::string_view name) {
+    return try_emplace(name).first.value();
+  }
+
+  void clear() {
+    destroy();
+    m_slabs.clear();
+    m_buckets.clear();
+  }
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// insertion ordered set of strings, the index of a string is its position in
+// items(), which is how the ndfbin string tables are written.
+// open addressing with linear probing, lookups take a string_view and every
+// bucket caches the hash, so strings are only compared on a hash match.
+class NDFSymbolTable {
+public:
+  static constexpr uint32_t no_index = 4294967295;
+
+private:
+  struct Bucket {
+    uint32_t hash = 0;
+    uint32_t index = no_index;
+  };
+  std::vector<std::string> m_items;
+  // power of two size, kept at most half full
+  std::vector<Bucket> m_buckets;
+
+  static uint32_t hash(std::string_view str) {
+    return static_cast<uint32_t>(std::hash<std::string_view>{}(str));
+  }
+
+  // returns the bucket of str or the empty bucket it would be inserted into
+  size_t find_bucket(std::string_view str, uint32_t h) const {
+    size_t mask = m_buckets.size() - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+      const Bucket &bucket = m_buckets[i];
+      if (bucket.index == no_index ||
+          (bucket.hash == h && m_items[bucket.index] == str)) {
+        return i;
+      }
+    }
+  }
+
+  void rehash(size_t bucket_count) {
+    std::vector<Bucket> buckets(bucket_count);
+    std::swap(buckets, m_buckets);
+    size_t mask = m_buckets.size() - 1;
+    for (const Bucket &bucket : buckets) {
+      if (bucket.index == no_index) {
+        continue;
+      }
+      size_t i = bucket.hash & mask;
+      while (m_buckets[i].index != no_index) {
+        i = (i + 1) & mask;
+      }
+      m_buckets[i] = bucket;
+    }
+  }
+
+public:
+  void reserve(size_t count) {
+    m_items.reserve(count);
+    size_t bucket_count = std::max<size_t>(16, m_buckets.size());
+    while (bucket_count < count * 2) {
+      bucket_count *= 2;
+    }
+    if (bucket_count != m_buckets.size()) {
+      rehash(bucket_count);
+    }
+  }
+
+  // returns no_index if str isn't in the table
+  uint32_t find(std::string_view str) const {
+    if (m_buckets.empty()) {
+      return no_index;
+    }
+    return m_buckets[find_bucket(str, hash(str))].index;
+  }
+  bool contains(std::string_view str) const { return find(str) != no_index; }
+
+  // returns the index of str, appending it if it's new
+  uint32_t get_or_add(std::string_view str) {
+    if ((m_items.size() + 1) * 2 > m_buckets.size()) {
+      rehash(std::max<size_t>(16, m_buckets.size() * 2));
+    }
+    uint32_t h = hash(str);
+    Bucket &bucket = m_buckets[find_bucket(str, h)];
+    if (bucket.index == no_index) {
+      bucket = {h, static_cast<uint32_t>(m_items.size())};
+      m_items.emplace_back(str);
+    }
+    return bucket.index;
+  }
+
+  const std::string &operator[](size_t index) const { return m_items[index]; }
+  const std::vector<std::string> &items() const { return m_items; }
+  size_t size() const { return m_items.size(); }
+  bool empty() const { return m_items.empty(); }
+
+  void clear() {
+    m_items.clear();
+    m_buckets.clear();
+  }
+};
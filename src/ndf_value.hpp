@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <variant>
+
+// compact form of the fixed size property values. lists, maps and pairs
+// loaded from ndfbin store their items as NDFValue instead of allocating an
+// NDFProperty per item, see NDFPropertyList::packed_values.
+// strings and import names are views into the tables of the NDF the value
+// was loaded by, they stay valid as long as that NDF keeps its ndfbin
+// loaded. get_copy of a container unpacks them, so the copy owns them.
+struct NDFStringValue {
+  std::string_view value;
+};
+struct NDFPathValue {
+  std::string_view path;
+};
+struct NDFObjectValue {
+  uint32_t object_index;
+};
+struct NDFImportValue {
+  std::string_view import_name;
+};
+struct NDFColorValue {
+  uint8_t b;
+  uint8_t g;
+  uint8_t r;
+  uint8_t a;
+};
+struct NDFGUIDValue {
+  std::array<uint8_t, 16> guid;
+};
+struct NDFLocalisationHashValue {
+  std::array<uint8_t, 8> hash;
+};
+struct NDFHashValue {
+  std::array<uint8_t, 16> hash;
+};
+
+// the order of the alternatives matches ndf_value_types below
+using NDFValue =
+    std::variant<bool, uint8_t, int16_t, uint16_t, int32_t, uint32_t, float,
+                 double, NDFStringValue, NDFPathValue, NDFObjectValue,
+                 NDFImportValue, std::array<float, 2>, std::array<float, 3>,
+                 std::array<float, 4>, std::array<int32_t, 2>,
+                 std::array<int32_t, 3>, NDFColorValue, NDFGUIDValue,
+                 NDFLocalisationHashValue, NDFHashValue>;
+
+// NDFPropertyType of every alternative of NDFValue, object and import
+// references are both 0x9
+inline constexpr std::array<uint32_t, std::variant_size_v<NDFValue>>
+    ndf_value_types = {0x0,  0x1,  0x18, 0x19, 0x2,  0x3,  0x5,
+                       0x6,  0x7,  0x1C, 0x9,  0x9,  0x21, 0xB,
+                       0xC,  0x1F, 0xE,  0xD,  0x1A, 0x1D, 0x25};
+
+inline uint32_t get_ndf_value_type(const NDFValue &value) {
+  return ndf_value_types[value.index()];
+}
+
+// true for the values that are views into the tables of an NDF
+inline bool is_ndf_value_view(const NDFValue &value) {
+  return std::holds_alternative<NDFStringValue>(value) ||
+         std::holds_alternative<NDFPathValue>(value) ||
+         std::holds_alternative<NDFImportValue>(value);
+}
@@ -252,12 +252,13 @@ void NDFPropertyS32_vec3::from_ndf_xml(const pugi::xml_node &node) {
 
 void NDFPropertyObjectReference::to_ndf_xml(pugi::xml_node &node) const {
   auto reference_node = node.append_child(property_name.c_str());
-  reference_node.append_attribute("object").set_value(object_name.c_str());
+  reference_node.append_attribute("object").set_value(get_object_name().c_str());
   reference_node.append_attribute("typeId").set_value(property_type);
   reference_node.append_attribute("referenceType").set_value("object");
 }
 void NDFPropertyObjectReference::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
+  object_index = no_object;
   object_name = node.attribute("object").as_string();
   assert(node.attribute("typeId").as_uint() == property_type);
   assert(node.attribute("referenceType").as_string() == std::string("object"));
@@ -279,23 +280,37 @@ void NDFPropertyImportReference::from_ndf_xml(const pugi::xml_node &node) {
 void NDFPropertyList::to_ndf_xml(pugi::xml_node &node) const {
   auto list_node = node.append_child(property_name.c_str());
   list_node.append_attribute("typeId").set_value(property_type);
-  for (auto const &value : values) {
+  if (is_packed()) {
+    for (auto const &value : unpacked_values()) {
+      value->to_ndf_xml(list_node);
+    }
+    return;
+  }
+  for (auto const &value : values()) {
     value->to_ndf_xml(list_node);
   }
 }
 void NDFPropertyList::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   for (auto const &value_node : node.children()) {
-    values.push_back(get_property_from_ndf_xml(
+    m_values.push_back(get_property_from_ndf_xml(
         value_node.attribute("typeId").as_uint(), value_node));
-    values.back()->from_ndf_xml(value_node);
+    m_values.back()->from_ndf_xml(value_node);
   }
 }
 
 void NDFPropertyMap::to_ndf_xml(pugi::xml_node &node) const {
   auto map_node = node.append_child(property_name.c_str());
   map_node.append_attribute("typeId").set_value(property_type);
-  for (auto const &[key, value] : values) {
+  if (is_packed()) {
+    for (auto const &[key, value] : unpacked_values()) {
+      auto map_items_node = map_node.append_child("MapItem");
+      key->to_ndf_xml(map_items_node);
+      value->to_ndf_xml(map_items_node);
+    }
+    return;
+  }
+  for (auto const &[key, value] : values()) {
     auto map_items_node = map_node.append_child("MapItem");
     key->to_ndf_xml(map_items_node);
     value->to_ndf_xml(map_items_node);
@@ -315,7 +330,7 @@ void NDFPropertyMap::from_ndf_xml(const pugi::xml_node &node) {
         value_node.attribute("typeId").as_uint(), value_node);
     value->from_ndf_xml(value_node);
 
-    values.push_back({std::move(key), std::move(value)});
+    m_values.push_back({std::move(key), std::move(value)});
   }
 }
 
@@ -343,12 +358,12 @@ void NDFPropertyUInt16::from_ndf_xml(const pugi::xml_node &node) {
 
 void NDFPropertyGUID::to_ndf_xml(pugi::xml_node &node) const {
   auto guid_node = node.append_child(property_name.c_str());
-  guid_node.append_attribute("guid").set_value(guid.c_str());
+  guid_node.append_attribute("guid").set_value(bytes_to_hex(guid).c_str());
   guid_node.append_attribute("typeId").set_value(property_type);
 }
 void NDFPropertyGUID::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
-  guid = node.attribute("guid").as_string();
+  guid = hex_to_bytes<16>(node.attribute("guid").as_string());
   assert(node.attribute("typeId").as_uint() == property_type);
 }
 
@@ -365,12 +380,12 @@ void NDFPropertyPathReference::from_ndf_xml(const pugi::xml_node &node) {
 
 void NDFPropertyLocalisationHash::to_ndf_xml(pugi::xml_node &node) const {
   auto hash_node = node.append_child(property_name.c_str());
-  hash_node.append_attribute("hash").set_value(hash.c_str());
+  hash_node.append_attribute("hash").set_value(bytes_to_hex(hash).c_str());
   hash_node.append_attribute("typeId").set_value(property_type);
 }
 void NDFPropertyLocalisationHash::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
-  hash = node.attribute("hash").as_string();
+  hash = hex_to_bytes<8>(node.attribute("hash").as_string());
   assert(node.attribute("typeId").as_uint() == property_type);
 }
 
@@ -403,6 +418,12 @@ void NDFPropertyF32_vec2::from_ndf_xml(const pugi::xml_node &node) {
 void NDFPropertyPair::to_ndf_xml(pugi::xml_node &node) const {
   auto pair_node = node.append_child(property_name.c_str());
   pair_node.append_attribute("typeId").set_value(property_type);
+  if (is_packed()) {
+    auto [unpacked_first, unpacked_second] = unpacked_values();
+    unpacked_first->to_ndf_xml(pair_node);
+    unpacked_second->to_ndf_xml(pair_node);
+    return;
+  }
   first->to_ndf_xml(pair_node);
   second->to_ndf_xml(pair_node);
 }
@@ -423,11 +444,11 @@ void NDFPropertyPair::from_ndf_xml(const pugi::xml_node &node) {
 
 void NDFPropertyHash::to_ndf_xml(pugi::xml_node &node) const {
   auto hash_node = node.append_child(property_name.c_str());
-  hash_node.append_attribute("hash").set_value(hash.c_str());
+  hash_node.append_attribute("hash").set_value(bytes_to_hex(hash).c_str());
   hash_node.append_attribute("typeId").set_value(property_type);
 }
 void NDFPropertyHash::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
-  hash = node.attribute("hash").as_string();
+  hash = hex_to_bytes<16>(node.attribute("hash").as_string());
   assert(node.attribute("typeId").as_uint() == property_type);
 }
@@ -1,18 +1,26 @@
 #include "ndf.hpp"
-
-#include <set>
+#include "ndf_dedup.hpp"
+#include "ndf_property_walker.hpp"
+#include "ndfbin_reader.hpp"
+#include "ndfbin_writer.hpp"
+#include "ndfbin_zlib.hpp"
 
 #include "utf.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <thread>
 
 #pragma pack(push, 1)
 struct NDFBinHeader {
   char magic[4] = {'E', 'U', 'G', '0'};
   char magic2[4] = {0, 0, 0, 0};
   char magic3[4] = {'C', 'N', 'D', 'F'};
+  // 0 or compressed_flag
   uint32_t compressed = 0;
   uint32_t toc0offset;
   char unk0[4] = {0, 0, 0, 0};
@@ -58,17 +66,27 @@ struct NDF_Type {
 };
 #pragma pack(pop)
 
-void NDF::load_from_ndfbin(fs::path path) {
-  std::ifstream file(path, std::ios::binary | std::ios::in);
-  if (!file.is_open()) {
-    throw std::runtime_error("Failed to open file " + path.string());
-  }
-  load_from_ndfbin_stream(file);
+// compressed files store the header as is, followed by the size of the
+// uncompressed body and the body as a zlib stream. all offsets in the header
+// and the TOC are offsets into the uncompressed file.
+static constexpr uint32_t compressed_flag = 128;
+
+void NDF::load_from_ndfbin(fs::path path, bool lazy, bool deduplicate) {
+  load_from_ndfbin_buffer(NDFBinBuffer::map_file(path), lazy, deduplicate);
 }
 
-void NDF::load_from_ndfbin_stream(std::istream &file) {
-  NDFBinHeader header;
-  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+void NDF::load_from_ndfbin_stream(std::istream &file, bool lazy,
+                                  bool deduplicate) {
+  load_from_ndfbin_buffer(NDFBinBuffer::read_stream(file), lazy, deduplicate);
+}
+
+static NDFBinReader get_section(const NDFBinReader &reader,
+                                const TOCTableEntry &entry) {
+  return reader.sub(entry.offset, entry.size);
+}
+
+static NDFBinHeader read_ndfbin_header(NDFBinReader &file) {
+  NDFBinHeader header = file.read<NDFBinHeader>();
 
   if (header.magic[0] != 'E' || header.magic[1] != 'U' ||
       header.magic[2] != 'G' || header.magic[3] != '0') {
@@ -83,10 +101,34 @@ void NDF::load_from_ndfbin_stream(std::istream &file) {
   if (header.headerSize != 40) {
     throw std::runtime_error("Invalid header size");
   }
+  return header;
+}
+
+// replaces a compressed file by the inflated one, so it can be decoded like
+// any other file. the body is inflated straight from the mapping or the
+// stream buffer into its final buffer.
+static std::unique_ptr<NDFBinBuffer>
+inflate_ndfbin(std::unique_ptr<NDFBinBuffer> buffer) {
+  NDFBinReader file(buffer->data());
+  NDFBinHeader header = read_ndfbin_header(file);
+  if (header.compressed == 0) {
+    return buffer;
+  }
+  if (file.read<uint32_t>() != header.size) {
+    throw std::runtime_error("ndfbin: uncompressed size doesn't match header");
+  }
+  spdlog::debug("inflating {} bytes", header.size);
+  std::vector<char> bytes(sizeof(NDFBinHeader) + header.size);
+  std::memcpy(bytes.data(), &header, sizeof(NDFBinHeader));
+  ndfbin_inflate(file.data().subspan(file.tell()),
+                 std::span(bytes).subspan(sizeof(NDFBinHeader)));
+  return NDFBinBuffer::from_bytes(std::move(bytes));
+}
 
-  TOCTable toc;
-  file.seekg(header.toc0offset);
-  file.read(reinterpret_cast<char *>(&toc), sizeof(toc));
+static TOCTable read_ndfbin_toc(NDFBinReader &file,
+                                const NDFBinHeader &header) {
+  file.seek(header.toc0offset);
+  TOCTable toc = file.read<TOCTable>();
 
   if (toc.magic[0] != 'T' || toc.magic[1] != 'O' || toc.magic[2] != 'C' ||
       toc.magic[3] != '0') {
@@ -96,425 +138,680 @@ void NDF::load_from_ndfbin_stream(std::istream &file) {
   if (toc.count != 9) {
     throw std::runtime_error("Invalid TOC count");
   }
+  return toc;
+}
 
+void NDF::load_ndfbin_tables(const NDFBinReader &file, const TOCTable &toc) {
   // load class names
-  file.seekg(toc.CLAS.offset);
-  uint32_t clas_endoffset = toc.CLAS.offset + toc.CLAS.size;
-  while ((uint32_t)file.tellg() < clas_endoffset) {
-    uint32_t length;
-    file.read(reinterpret_cast<char *>(&length), sizeof(length));
-    std::string class_name;
-    class_name.resize(length);
-    file.read(class_name.data(), length * sizeof(char));
+  NDFBinReader clas = get_section(file, toc.CLAS);
+  while (!clas.at_end()) {
+    std::string_view class_name = clas.read_length_string();
     class_table.push_back(class_name);
     spdlog::debug("Class: {}", class_name);
   }
 
   // load strings
-  file.seekg(toc.STRG.offset);
-  uint32_t strg_endoffset = toc.STRG.offset + toc.STRG.size;
-  while ((uint32_t)file.tellg() < strg_endoffset) {
-    uint32_t length;
-    file.read(reinterpret_cast<char *>(&length), sizeof(length));
-    std::string string;
-    string.resize(length);
-    file.read(string.data(), length * sizeof(char));
+  NDFBinReader strg = get_section(file, toc.STRG);
+  while (!strg.at_end()) {
+    std::string_view string = strg.read_length_string();
     string_table.push_back(string);
     spdlog::debug("String: {}", string);
   }
 
   // load tran table
-  file.seekg(toc.TRAN.offset);
-  uint32_t tran_endoffset = toc.TRAN.offset + toc.TRAN.size;
-  while ((uint32_t)file.tellg() < tran_endoffset) {
-    uint32_t length;
-    file.read(reinterpret_cast<char *>(&length), sizeof(length));
-    std::string string;
-    string.resize(length);
-    file.read(string.data(), length * sizeof(char));
+  NDFBinReader tran = get_section(file, toc.TRAN);
+  while (!tran.at_end()) {
+    std::string_view string = tran.read_length_string();
     spdlog::debug("Tran: {}", string);
     tran_table.push_back(string);
   }
 
   // load properties
-  file.seekg(toc.PROP.offset);
-  uint32_t prop_endoffset = toc.PROP.offset + toc.PROP.size;
-  while ((uint32_t)file.tellg() < prop_endoffset) {
-    uint32_t str_len;
-    file.read(reinterpret_cast<char *>(&str_len), sizeof(str_len));
-    std::string prop_name;
-    prop_name.resize(str_len);
-    file.read(prop_name.data(), str_len * sizeof(char));
-    uint32_t class_idx;
-    file.read(reinterpret_cast<char *>(&class_idx), sizeof(class_idx));
+  NDFBinReader prop_section = get_section(file, toc.PROP);
+  while (!prop_section.at_end()) {
+    std::string_view prop_name = prop_section.read_length_string();
+    uint32_t class_idx = prop_section.read<uint32_t>();
     spdlog::debug("Property: {} {}", prop_name, class_idx);
     property_table.emplace_back(prop_name, class_idx);
   }
 
   // load imports
-  file.seekg(toc.IMPR.offset);
-  uint32_t impr_endoffset = toc.IMPR.offset + toc.IMPR.size;
-  while ((uint32_t)file.tellg() < impr_endoffset) {
-    load_imprs(file, {});
+  NDFBinReader impr = get_section(file, toc.IMPR);
+  load_imprs(impr);
+}
+
+void NDF::load_from_ndfbin_buffer(std::unique_ptr<NDFBinBuffer> buffer,
+                                  bool lazy, bool deduplicate) {
+  // the tables, lazy objects and packed values of a previous load point into
+  // its buffer, and the indices of the file only match fresh tables
+  clear();
+  ndfbin_buffer = inflate_ndfbin(std::move(buffer));
+  NDFBinReader file(ndfbin_buffer->data());
+  TOCTable toc = read_ndfbin_toc(file, read_ndfbin_header(file));
+  load_ndfbin_tables(file, toc);
+
+  // the schema starts out as CLAS/PROP of the file, so the loaded objects
+  // don't have to be walked to build it
+  std::vector<uint32_t> schema_classes;
+  for (auto class_name : class_table) {
+    schema_classes.push_back(schema.add_class(class_name));
+  }
+  for (const auto &[prop_name, class_idx] : property_table) {
+    schema.add_indexed_property(schema_classes.at(class_idx), prop_name);
   }
 
-  // load objects
-  file.seekg(toc.OBJE.offset);
-  spdlog::debug("0x{:02X} Object Table", (uint32_t)file.tellg());
-  uint32_t obje_endoffset = toc.OBJE.offset + toc.OBJE.size;
-  while ((uint32_t)file.tellg() < obje_endoffset) {
-    NDF_Object obj;
-    file.read(reinterpret_cast<char *>(&obj), sizeof(obj));
+  // objects using every PROP entry, counted in the first pass
+  std::vector<uint32_t> property_users(property_table.size());
+
+  // load objects, first pass only finds the object boundaries by skipping
+  // over the properties
+  NDFBinReader obje = get_section(file, toc.OBJE);
+  spdlog::debug("0x{:02X} Object Table", toc.OBJE.offset);
+  // objects are added right away, they don't move when more are added and
+  // are decoded in place below
+  while (!obje.at_end()) {
+    NDF_Object obj = obje.read<NDF_Object>();
 
     NDFObject object;
-    object.name = "Object_" + std::to_string(object_map.size());
-    obj.classIndex = obj.classIndex;
-    object.class_name = class_table[obj.classIndex];
+    // object references only store the index, the objects stay unnamed until
+    // they are accessed, see get_object_name
+    object.class_name = class_table.at(obj.classIndex);
 
-    spdlog::debug("0x{:02X} Object: {} ({})", (uint32_t)file.tellg(),
-                  object.name, object.class_name);
+    spdlog::debug("0x{:02X} Object: {} ({})", toc.OBJE.offset + obje.tell(),
+                  object_map.size(), object.class_name);
 
-    // load properties
-    NDF_Property prop{0};
-    while (prop.propertyIndex != 2880154539) {
-      file.read(reinterpret_cast<char *>(&prop), sizeof(prop));
+    object.properties_loaded = false;
+    object.ndfbin_offset = toc.OBJE.offset + obje.tell();
+    while (true) {
+      NDF_Property prop = obje.read<NDF_Property>();
       if (prop.propertyIndex == 2880154539) {
         break;
       }
-      uint32_t ndf_type = 0xFFFFFFFF;
-      file.read(reinterpret_cast<char *>(&ndf_type), sizeof(ndf_type));
+      property_users.at(prop.propertyIndex)++;
+      NDFProperty::skip_ndfbin(obje.read<uint32_t>(), obje);
+    }
+    object.ndfbin_size = toc.OBJE.offset + obje.tell() - object.ndfbin_offset;
+    // counted with the property_users of the file, see remove_from_schema
+    object.schema_modifications = object.modifications;
+    object.schema_class = schema_classes.at(obj.classIndex);
+    object.owner = this;
+    object_map.append_unnamed(std::move(object));
+  }
 
-      auto property = NDFProperty::get_property_from_ndfbin(ndf_type, file);
-      property->from_ndfbin(this, file);
-      property->property_name = property_table[prop.propertyIndex].first;
+  for (const auto &[prop_idx, users] : property_users | std::views::enumerate) {
+    const auto &[prop_name, class_idx] = property_table[prop_idx];
+    schema.add_property(schema_classes[class_idx], prop_name, users);
+  }
 
-      object.add_property(std::move(property));
+  // second pass decodes the properties, objects only depend on the tables
+  // loaded above so they can be decoded in parallel
+  if (!lazy) {
+    std::optional<NDFPropertyDeduplicator> deduplicator;
+    if (deduplicate) {
+      deduplicator.emplace();
+    }
+    decode_ndfbin_objects(get_section(file, toc.OBJE), toc.OBJE.offset,
+                          deduplicator ? &*deduplicator : nullptr);
+    if (deduplicator) {
+      set_dedup_stats(deduplicator->take_stats());
     }
-    add_object(std::move(object));
   }
 
-  fill_gen_object();
-
   // load exports
-  file.seekg(toc.EXPR.offset);
-  uint32_t expr_endoffset = toc.EXPR.offset + toc.EXPR.size;
-  while ((uint32_t)file.tellg() < expr_endoffset) {
-    load_exprs(file, {});
-  }
+  NDFBinReader expr = get_section(file, toc.EXPR);
+  load_exprs(expr);
 
   // load TOPO
-  file.seekg(toc.TOPO.offset);
-  uint32_t topo_endoffset = toc.TOPO.offset + toc.TOPO.size;
-  while ((uint32_t)file.tellg() < topo_endoffset) {
-    uint32_t object_index;
-    file.read(reinterpret_cast<char *>(&object_index), sizeof(object_index));
-    object_map[gen_object_items[object_index]].is_top_object = true;
+  NDFBinReader topo = get_section(file, toc.TOPO);
+  while (!topo.at_end()) {
+    uint32_t object_index = topo.read<uint32_t>();
+    if (object_index >= object_map.size()) {
+      throw std::runtime_error("ndfbin: TOPO references unknown object");
+    }
+    object_map.get(object_index).is_top_object = true;
   }
 }
 
-void NDF::save_ndfbin_imprs(
-    const std::map<std::vector<uint32_t>, uint32_t> &gen_table,
-    std::ostream &stream) {
-  // we need for every node the count of the children of this node
-  std::map<std::vector<uint32_t>, uint32_t> count_table;
-  {
-    std::set<std::vector<uint32_t>> visited_subpaths;
-    for (const auto &[k, v] : gen_table) {
-      {
-        std::string key_str = "";
-        for (auto const &foo : k) {
-          key_str += gen_tran_table[foo] + "/";
-        }
-        spdlog::debug("count_table: {}", key_str);
+void NDF::visit_ndfbin(fs::path path, NDFBinVisitor &visitor) {
+  NDF ndf;
+  ndf.visit_ndfbin_buffer(NDFBinBuffer::map_file(path), visitor);
+}
+
+void NDF::visit_ndfbin_stream(std::istream &stream, NDFBinVisitor &visitor) {
+  NDF ndf;
+  ndf.visit_ndfbin_buffer(NDFBinBuffer::read_stream(stream), visitor);
+}
+
+void NDF::visit_ndfbin_buffer(std::unique_ptr<NDFBinBuffer> buffer,
+                              NDFBinVisitor &visitor) {
+  ndfbin_buffer = inflate_ndfbin(std::move(buffer));
+  NDFBinReader file(ndfbin_buffer->data());
+  TOCTable toc = read_ndfbin_toc(file, read_ndfbin_header(file));
+  load_ndfbin_tables(file, toc);
+
+  NDFBinReader obje = get_section(file, toc.OBJE);
+  for (uint32_t index = 0; !obje.at_end(); index++) {
+    NDF_Object obj = obje.read<NDF_Object>();
+    bool visit = visitor.begin_object(index, class_table.at(obj.classIndex));
+    while (true) {
+      NDF_Property prop = obje.read<NDF_Property>();
+      if (prop.propertyIndex == 2880154539) {
+        break;
       }
-      std::vector<uint32_t> current_part = {k[0]};
-      for (const auto &i :
-           k | std::views::drop(1) | std::views::take(k.size() - 1)) {
-        std::vector<uint32_t> sub_part = current_part;
-        current_part.push_back(i);
-
-        if (visited_subpaths.find(current_part) == visited_subpaths.end()) {
-          if (count_table.find(sub_part) == count_table.end()) {
-            count_table[sub_part] = 1;
-          } else {
-            count_table[sub_part] += 1;
-          }
-          visited_subpaths.insert(current_part);
-        }
-        {
-          std::string key_str = "";
-          for (auto const &foo : sub_part) {
-            key_str += gen_tran_table[foo] + "/";
-          }
-          spdlog::debug("count_table import: {} -> {}", key_str,
-                        count_table[sub_part]);
-        }
+      uint32_t ndf_type = obje.read<uint32_t>();
+      if (visit) {
+        NDFProperty::visit_ndfbin(this,
+                                  property_table.at(prop.propertyIndex).first,
+                                  ndf_type, obje, visitor);
+      } else {
+        NDFProperty::skip_ndfbin(ndf_type, obje);
       }
     }
+    if (visit) {
+      visitor.end_object(index);
+    }
   }
+}
 
-  std::vector<uint32_t> previous_import_path = {};
-  std::vector<std::pair<uint32_t, std::vector<uint32_t>>> previous_offsets = {};
-  for (const auto &[k, v] : gen_table) {
-    {
-      std::string key_str = "";
-      for (auto const &foo : k) {
-        key_str += gen_tran_table[foo] + "/";
-      }
-      spdlog::debug("Import: {} -> {}", key_str, v);
+NDFBinSummary NDF::probe_ndfbin(fs::path path, NDFBinProbeOptions options) {
+  NDFBinSummary ret;
+  ret.path = path;
+  // only the pages of the header, TOC and requested sections get read. the
+  // TOC of compressed files is at the end of the body, so they are inflated
+  auto buffer = inflate_ndfbin(NDFBinBuffer::map_file(path));
+  NDFBinReader file(buffer->data());
+  NDFBinHeader header = read_ndfbin_header(file);
+  ret.size = header.size;
+  ret.compressed = header.compressed != 0;
+
+  TOCTable toc = read_ndfbin_toc(file, header);
+  for (const TOCTableEntry *entry :
+       {&toc.OBJE, &toc.TOPO, &toc.CHNK, &toc.CLAS, &toc.PROP, &toc.STRG,
+        &toc.TRAN, &toc.IMPR, &toc.EXPR}) {
+    ret.sections.push_back(
+        {std::string(entry->magic, 4), entry->offset, entry->size});
+  }
+
+  if (options.chunks && toc.CHNK.size >= sizeof(uint32_t)) {
+    ret.object_count = get_section(file, toc.CHNK).read<uint32_t>();
+  }
+
+  if (options.classes) {
+    NDFBinReader clas = get_section(file, toc.CLAS);
+    while (!clas.at_end()) {
+      ret.class_names.emplace_back(clas.read_length_string());
     }
+  }
 
-    // first we get the diff to the last run
-    int diff_point = 0;
-    std::vector<uint32_t> current_path;
-    for (unsigned int x = 0; x < k.size(); x++) {
-      if (x >= previous_import_path.size()) {
-        diff_point = x;
-        // spdlog::debug("diff_point size: {} {}", previous_import_path.size(),
-        // x);
-        break;
-      }
-      if (previous_import_path[x] != k[x]) {
-        diff_point = x;
-        // spdlog::debug("diff_point diff {} {}", previous_import_path[x],
-        // k[x]);
-        break;
-      }
-      // we do not add the item that differs
-      current_path.push_back(k[x]);
+  if (options.properties) {
+    NDFBinReader prop = get_section(file, toc.PROP);
+    while (!prop.at_end()) {
+      std::string_view prop_name = prop.read_length_string();
+      uint32_t class_idx = prop.read<uint32_t>();
+      ret.property_names.emplace_back(prop_name, class_idx);
     }
-    // now shorten the previous import_path and import xml nodes to the diff
-    // point
-    // spdlog::debug("diff_point: {}", diff_point);
-    {
-      std::string key_str = "";
-      for (auto const &foo : previous_import_path) {
-        key_str += gen_tran_table[foo] + "/";
-      }
-      spdlog::debug("before shorten prev Import path: {} -> {}", key_str, v);
-    }
-    int diff = previous_offsets.size() - diff_point;
-    for (int x = 0; x < diff; x++) {
-      // fix previously empty offsets
-      auto &[offset, offsets] = previous_offsets.back();
-      uint32_t prev_loc = stream.tellp();
-      stream.seekp(offset);
-      stream.write(reinterpret_cast<char *>(offsets.data()),
-                   offsets.size() * sizeof(uint32_t));
-
-      {
-        std::string key_str = "";
-        for (auto const &foo : previous_import_path) {
-          key_str += gen_tran_table[foo] + "/";
-        }
-        // spdlog::debug("IMPORT: {} -> {}", key_str, v);
+  }
+  return ret;
+}
+
+std::vector<NDFBinSummary>
+NDF::probe_ndfbin_directory(fs::path directory, NDFBinProbeOptions options) {
+  std::vector<fs::path> paths;
+  for (const auto &entry : fs::recursive_directory_iterator(directory)) {
+    if (entry.is_regular_file() && entry.path().extension() == ".ndfbin") {
+      paths.push_back(entry.path());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  spdlog::debug("probing {} ndfbin files in {}", paths.size(),
+                directory.string());
+
+  std::vector<NDFBinSummary> ret(paths.size());
+  std::atomic<size_t> next = 0;
+  auto worker = [&]() {
+    for (size_t i = next++; i < paths.size(); i = next++) {
+      try {
+        ret[i] = probe_ndfbin(paths[i], options);
+      } catch (const std::exception &e) {
+        ret[i].path = paths[i];
+        ret[i].error = e.what();
       }
+    }
+  };
+  size_t thread_count = std::clamp<size_t>(
+      paths.size(), 1, std::max(1u, std::thread::hardware_concurrency()));
+  {
+    std::vector<std::jthread> threads;
+    for (size_t t = 1; t < thread_count; t++) {
+      threads.emplace_back(worker);
+    }
+    worker();
+  }
+  return ret;
+}
 
-      size_t count = count_table[previous_import_path];
-      spdlog::debug("COUNT {} {}", count, offsets.size());
-      assert(count == offsets.size());
+void NDF::decode_ndfbin_properties(NDFObject &object, NDFBinReader &reader,
+                                   NDFPropertyDeduplicator *deduplicator) {
+  NDFArena *arena = NDFArena::current();
+  while (true) {
+    NDF_Property prop = reader.read<NDF_Property>();
+    if (prop.propertyIndex == 2880154539) {
+      break;
+    }
+    uint32_t ndf_type = reader.read<uint32_t>();
+
+    std::optional<NDFArena::Mark> mark;
+    if (arena) {
+      mark = arena->mark();
+    }
+    auto decoded = NDFProperty::read_ndfbin(ndf_type, this, reader);
+    decoded->property_name = property_table.at(prop.propertyIndex).first;
+    NDFPropertyRef property = std::move(decoded);
+    // a duplicate was the last thing allocated, so its memory can be reused
+    if (deduplicator && NDFPropertyDeduplicator::is_candidate(*property) &&
+        deduplicator->share(property, object.class_name) && mark) {
+      arena->rewind(*mark);
+    }
 
-      spdlog::debug("WRITE offsets {} {} @0x{:02X}", previous_offsets.size(),
-                    previous_offsets.back().second.size(), (uint32_t)offset);
+    // not a modification, unlike NDFObject::add_property
+    object.m_properties.push_back(std::move(property));
+  }
+}
 
-      stream.seekp(prev_loc);
-      previous_import_path.pop_back();
-      previous_offsets.pop_back();
+void NDF::decode_ndfbin_objects(const NDFBinReader &obje, uint32_t obje_offset,
+                                NDFPropertyDeduplicator *deduplicator) {
+  size_t object_count = object_map.size();
+  // small files aren't worth spawning threads for
+  constexpr size_t min_objects_per_thread = 256;
+  size_t thread_count = std::clamp<size_t>(
+      object_count / min_objects_per_thread, 1,
+      std::max(1u, std::thread::hardware_concurrency()));
+
+  // one arena per thread
+  auto decode_range = [&](NDFArena *arena, size_t begin, size_t end) {
+    NDFArena::Scope arena_scope(arena);
+    NDFBinReader reader = obje;
+    for (size_t i = begin; i < end; i++) {
+      auto &object = object_map.get(i);
+      reader.seek(object.ndfbin_offset - obje_offset);
+      decode_ndfbin_properties(object, reader, deduplicator);
+      object.properties_loaded = true;
     }
-    {
-      std::string key_str = "";
-      for (auto const &foo : previous_import_path) {
-        key_str += gen_tran_table[foo] + "/";
-      }
-      // spdlog::debug("after shorten prev Import path: {} -> {}", key_str, v);
-    }
-    assert(previous_offsets.size() == previous_import_path.size());
-
-    for (unsigned int x = diff_point; x < k.size(); x++) {
-      // if not first node, add offset to the offsets array
-      if (previous_offsets.size() != 0) {
-        auto &[offset, offsets] = previous_offsets.back();
-        offsets.push_back((uint32_t)stream.tellp() - offset);
-        spdlog::debug(
-            "ADD OFFSET prev_offsets @0x{:02X} {} offsets {} 0x{:02X}", offset,
-            previous_offsets.size(), offsets.size(), offsets.back());
-      }
+  };
+
+  // at most one chunk per thread is left partly unused
+  size_t arena_chunk_size = std::clamp<size_t>(obje.size() / thread_count,
+                                               64 * 1024, 1024 * 1024);
+  if (thread_count == 1) {
+    decode_range(add_arena(arena_chunk_size), 0, object_map.size());
+    return;
+  }
 
-      // we now update the current_path and search for a possible import
-      current_path.push_back(k[x]);
-
-      // same layer -> add new node
-      // write tranIndex, index and count
-      uint32_t tranIndex = k[x];
-      uint32_t index = 4294967295;
-      // search for import
-      auto impr_index_it = gen_table.find(current_path);
-      if (impr_index_it != gen_table.end()) {
-        index = impr_index_it->second;
-      }
-      uint32_t count = count_table[current_path];
-
-      stream.write(reinterpret_cast<char *>(&tranIndex), sizeof(tranIndex));
-      stream.write(reinterpret_cast<char *>(&index), sizeof(index));
-      stream.write(reinterpret_cast<char *>(&count), sizeof(count));
-
-      // create offsets table
-      previous_offsets.push_back({stream.tellp(), {}});
-      spdlog::debug("ARRAY @0x{:02X} count {}", (uint32_t)stream.tellp(),
-                    count);
-      // write table with wrong info
-      std::vector<uint32_t> offsets;
-      offsets.resize(count);
-      stream.write(reinterpret_cast<char *>(offsets.data()),
-                   offsets.size() * sizeof(uint32_t));
-
-      {
-        std::string key_str = "";
-        for (auto const &foo : current_path) {
-          key_str += gen_tran_table[foo] + "/";
+  spdlog::debug("decoding {} objects on {} threads", object_count,
+                thread_count);
+  std::vector<std::exception_ptr> errors(thread_count);
+  {
+    std::vector<std::jthread> threads;
+    size_t chunk = (object_count + thread_count - 1) / thread_count;
+    for (size_t t = 0; t < thread_count; t++) {
+      size_t begin = std::min(object_map.size(), t * chunk);
+      size_t end = std::min(object_map.size(), begin + chunk);
+      NDFArena *arena = add_arena(arena_chunk_size);
+      threads.emplace_back([&, t, arena, begin, end]() {
+        try {
+          decode_range(arena, begin, end);
+        } catch (...) {
+          errors[t] = std::current_exception();
         }
-        spdlog::debug("ARRAY IMPORT: {} -> {}", key_str, v);
+      });
+    }
+  }
+  for (auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+void NDF::save_ndfbin_object(NDFBinWriter &writer, uint32_t obj_idx,
+                             const NDFObject &obj) {
+  uint32_t class_idx = gen_object_classes[obj_idx];
+  spdlog::debug("writing classidx @0x{:02X} {}", (uint32_t)writer.tell(),
+                class_idx);
+  writer.write(class_idx);
+
+  for (auto &property : obj.properties()) {
+    uint32_t property_idx =
+        schema.find_property(class_idx, property->property_name);
+    if (property_idx == NDFSymbolTable::no_index) {
+      throw std::runtime_error(
+          std::format("Property {} of object {} is not in the schema",
+                      property->property_name.str(),
+                      get_object_name(obj_idx)));
+    }
+    spdlog::debug("writing propidx @0x{:02X} {}", (uint32_t)writer.tell(),
+                  property_idx);
+    writer.write(property_idx);
+    uint32_t ndf_type = property->property_type;
+    spdlog::debug("writing ndf_type @0x{:02X} {}", (uint32_t)writer.tell(),
+                  ndf_type);
+    writer.write(ndf_type);
+    property->to_ndfbin(this, writer);
+  }
+  // write last property
+  uint32_t property_idx = 2880154539;
+  writer.write(property_idx);
+}
+
+// rewrites the provisional indices of a chunk written at base
+static void remap_ndfbin_indices(NDFBinWriter &writer, size_t base,
+                                 std::span<const char> chunk,
+                                 const NDFBinLocalTable &table,
+                                 const std::vector<uint32_t> &indices) {
+  for (size_t position : table.positions) {
+    uint32_t local_index;
+    std::memcpy(&local_index, chunk.data() + position, sizeof(local_index));
+    writer.patch(base + position, indices[local_index]);
+  }
+}
+
+void NDF::save_ndfbin_objects(NDFBinWriter &writer) {
+  // small files aren't worth spawning threads for
+  constexpr size_t min_objects_per_thread = 256;
+  size_t thread_count = std::clamp<size_t>(
+      object_map.size() / min_objects_per_thread, 1,
+      std::max(1u, std::thread::hardware_concurrency()));
+
+  if (!gen_object_unchanged.empty()) {
+    // incremental save, the class index and the properties of unchanged
+    // objects are copied as is
+    auto data = ndfbin_buffer->data();
+    for (const auto &[obj_idx, it] : object_map | std::views::enumerate) {
+      const auto &obj = it.second;
+      if (gen_object_unchanged[obj_idx]) {
+        writer.write_bytes(data.data() + obj.ndfbin_offset - sizeof(uint32_t),
+                           obj.ndfbin_size + sizeof(uint32_t));
+      } else {
+        save_ndfbin_object(writer, obj_idx, obj);
       }
     }
+    return;
+  }
+
+  if (thread_count == 1) {
+    for (const auto &[obj_idx, it] : object_map | std::views::enumerate) {
+      save_ndfbin_object(writer, obj_idx, it.second);
+    }
+    return;
+  }
 
-    previous_import_path = current_path;
+  // every chunk is written into its own buffer with local string and import
+  // tables, the chunks are then merged in order, so the global tables are
+  // filled in the same order as by the serial writer
+  spdlog::debug("writing {} objects on {} threads", object_map.size(),
+                thread_count);
+  size_t chunk = (object_map.size() + thread_count - 1) / thread_count;
+  std::vector<NDFBinWriter> writers(thread_count);
+  std::vector<NDFBinLocalSymbols> symbols(thread_count);
+  std::vector<std::exception_ptr> errors(thread_count);
+  {
+    std::vector<std::jthread> threads;
+    for (size_t t = 0; t < thread_count; t++) {
+      size_t begin = std::min(object_map.size(), t * chunk);
+      size_t end = std::min(object_map.size(), begin + chunk);
+      threads.emplace_back([&, t, begin, end]() {
+        try {
+          writers[t].local_symbols = &symbols[t];
+          for (size_t i = begin; i < end; i++) {
+            save_ndfbin_object(writers[t], i, object_map.get(i));
+          }
+        } catch (...) {
+          errors[t] = std::current_exception();
+        }
+      });
+    }
+  }
+  for (auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
   }
-  int s = previous_offsets.size();
-  for (int x = 0; x < s; x++) {
-    spdlog::debug("SIZE {} {}", x, previous_offsets.size());
-    // fix previously empty offsets
-    auto &[offset, offsets] = previous_offsets.back();
-    uint32_t prev_loc = stream.tellp();
-    stream.seekp(offset);
-    stream.write(reinterpret_cast<char *>(offsets.data()),
-                 offsets.size() * sizeof(uint32_t));
 
-    size_t count = count_table[previous_import_path];
-    spdlog::debug("COUNT {} {}", count, offsets.size());
-    assert(count == offsets.size());
+  std::vector<uint32_t> indices;
+  for (size_t t = 0; t < thread_count; t++) {
+    size_t base = writer.tell();
+    auto data = writers[t].data();
+    writer.write_bytes(data.data(), data.size());
 
-    spdlog::debug("WRITE offsets {} {} @0x{:02X}", previous_offsets.size(),
-                  previous_offsets.back().second.size(), (uint32_t)offset);
+    indices.clear();
+    for (auto str : symbols[t].strings.items) {
+      indices.push_back(get_or_add_string(str));
+    }
+    remap_ndfbin_indices(writer, base, data, symbols[t].strings, indices);
 
-    stream.seekp(prev_loc);
-    previous_import_path.pop_back();
-    previous_offsets.pop_back();
+    indices.clear();
+    for (auto impr : symbols[t].imports.items) {
+      indices.push_back(get_or_add_impr(impr));
+    }
+    remap_ndfbin_indices(writer, base, data, symbols[t].imports, indices);
   }
 }
 
-void NDF::save_as_ndfbin(fs::path path) {
+void NDF::load_object_properties(NDFObject &object) {
+  assert(ndfbin_buffer);
+  spdlog::debug("lazy loading object {} @0x{:02X}", object.name,
+                object.ndfbin_offset);
+  NDFArena::Scope arena_scope(get_arena());
+  NDFBinReader reader(ndfbin_buffer->data());
+  reader.seek(object.ndfbin_offset);
+  decode_ndfbin_properties(object, reader);
+  object.properties_loaded = true;
+}
+
+void NDF::load_all_objects() {
+  for (auto it = object_map.begin(); it != object_map.end(); ++it) {
+    if (!it.value().properties_loaded) {
+      load_object_properties(it.value());
+    }
+  }
+}
+
+void NDF::save_as_ndfbin(fs::path path, bool incremental, bool compressed) {
+#ifdef _WIN32
+  // windows can't replace a file that is still mapped
+  std::error_code error;
+  if (ndfbin_buffer && ndfbin_buffer->is_mapped() &&
+      fs::equivalent(path, ndfbin_buffer->mapped_path(), error)) {
+    throw std::runtime_error(
+        std::format("Can't overwrite {} while it is mapped, save to another "
+                    "path or load it with load_from_ndfbin_stream",
+                    path.string()));
+  }
+#endif
   fs::create_directories(path.parent_path());
-  std::fstream ofs(path, std::fstream::in | std::fstream::out |
-                             std::fstream::binary | std::fstream::trunc);
-  if (!ofs.is_open()) {
-    throw std::runtime_error("Failed to open file " + path.string());
+  // the loaded file may be mapped, so don't truncate it in place. writing a
+  // new file and renaming it keeps the mapping of the old one valid
+  fs::path tmp_path = path;
+  tmp_path += ".tmp";
+  try {
+    {
+      std::ofstream ofs(tmp_path, std::ios::binary | std::ios::trunc);
+      if (!ofs.is_open()) {
+        throw std::runtime_error("Failed to open file " + tmp_path.string());
+      }
+      save_as_ndfbin_stream(ofs, incremental, compressed);
+    }
+    fs::rename(tmp_path, path);
+  } catch (...) {
+    std::error_code error;
+    fs::remove(tmp_path, error);
+    throw;
   }
-  save_as_ndfbin_stream(ofs);
 }
 
-void NDF::save_as_ndfbin_stream(std::ostream &ofs) {
-  gen_object_items.clear();
-  gen_object_table.clear();
-  gen_string_items.clear();
-  gen_string_table.clear();
-  gen_clas_items.clear();
-  gen_clas_table.clear();
-  gen_topo_table.clear();
-  gen_tran_items.clear();
-  gen_tran_table.clear();
-  gen_import_table.clear();
-  gen_import_items.clear();
-  gen_export_table.clear();
-  gen_export_items.clear();
-  gen_property_table.clear();
-
-  fill_gen_object();
+// looks for references to the objects set in objects
+struct NDFObjectReferenceFinder
+    : NDFPropertyWalker<NDFObjectReferenceFinder> {
+  const std::vector<bool> &objects;
+  bool found = false;
+
+  explicit NDFObjectReferenceFinder(const std::vector<bool> &objects)
+      : objects(objects) {}
+
+  void find(uint32_t object_index) {
+    found = found || (object_index < objects.size() && objects[object_index]);
+  }
+  using NDFPropertyWalker::leaf;
+  void leaf(const NDFPropertyObjectReference &reference) {
+    find(reference.object_index);
+  }
+  void value(const NDFValue &value) {
+    if (auto *reference = std::get_if<NDFObjectValue>(&value)) {
+      find(reference->object_index);
+    }
+  }
+  // raw words are never references
+  void packed_words(const NDFPropertyList &) {}
+};
+
+bool NDF::seed_gen_tables() {
+  for (auto str : string_table) {
+    if (gen_strings.get_or_add(str) != gen_strings.size() - 1) {
+      return false;
+    }
+  }
+  for (auto tran : tran_table) {
+    if (gen_trans.get_or_add(tran) != gen_trans.size() - 1) {
+      return false;
+    }
+  }
+  // the schema starts out with CLAS/PROP of the loaded file and only grows,
+  // unless it was rebuilt
+  if (schema.classes.size() < class_table.size() ||
+      schema.properties.size() < property_table.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < class_table.size(); i++) {
+    if (schema.classes[i] != class_table[i]) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < property_table.size(); i++) {
+    if (schema.properties[i].first != property_table[i].first ||
+        schema.properties[i].second != property_table[i].second) {
+      return false;
+    }
+  }
+  for (const auto &[import_idx, import_name] : import_name_table) {
+    if (get_or_add_impr(import_name) != import_idx) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void NDF::save_as_ndfbin_stream(std::ostream &ofs, bool incremental,
+                                bool compressed) {
+  clear_gen_tables();
+  update_schema();
+  if (incremental && ndfbin_buffer) {
+    if (!seed_gen_tables()) {
+      spdlog::debug("tables can't be reused, saving all objects");
+      clear_gen_tables();
+      incremental = false;
+    }
+  } else {
+    incremental = false;
+  }
+
+  if (incremental) {
+    // objects are unchanged if they were loaded from the current buffer,
+    // weren't modified and still have their original class
+    auto data = ndfbin_buffer->data();
+    std::vector<bool> class_changed(object_map.size());
+    bool any_class_changed = false;
+    for (auto it = object_map.begin(); it != object_map.end(); ++it) {
+      const auto &obj = it.value();
+      if (obj.ndfbin_size == 0) {
+        gen_object_unchanged.push_back(false);
+        continue;
+      }
+      uint32_t class_idx;
+      std::memcpy(&class_idx,
+                  data.data() + obj.ndfbin_offset - sizeof(uint32_t),
+                  sizeof(class_idx));
+      class_changed[it.index()] =
+          class_idx != schema.find_class(obj.class_name);
+      any_class_changed = any_class_changed || class_changed[it.index()];
+      // the properties can't change without modifications
+      gen_object_unchanged.push_back(obj.modifications == 0 &&
+                                     !class_changed[it.index()]);
+    }
+    // object references store the class index of the object, so objects
+    // referencing an object with a new class have to be encoded again. rare
+    // enough to decode the unchanged objects to find them.
+    if (any_class_changed) {
+      for (auto it = object_map.begin(); it != object_map.end(); ++it) {
+        if (!gen_object_unchanged[it.index()]) {
+          continue;
+        }
+        auto &obj = it.value();
+        if (!obj.properties_loaded) {
+          load_object_properties(obj);
+        }
+        NDFObjectReferenceFinder finder(class_changed);
+        for (const auto &property : obj.properties()) {
+          finder.walk(*property);
+        }
+        gen_object_unchanged[it.index()] = !finder.found;
+      }
+    }
+    for (auto it = object_map.begin(); it != object_map.end(); ++it) {
+      if (!gen_object_unchanged[it.index()] && !it.value().properties_loaded) {
+        load_object_properties(it.value());
+      }
+    }
+  } else {
+    load_all_objects();
+  }
+
+  // the whole file is built in memory and written at once, a loaded file is
+  // a good estimate for its own size
+  NDFBinWriter writer(ndfbin_buffer ? ndfbin_buffer->size()
+                                    : object_map.size() * 256);
 
   NDFBinHeader header;
   TOCTable toc_table;
 
-  ofs.write(reinterpret_cast<char *>(&header), sizeof(header));
+  writer.write(header);
 
   toc_table.OBJE.magic[0] = 'O';
   toc_table.OBJE.magic[1] = 'B';
   toc_table.OBJE.magic[2] = 'J';
   toc_table.OBJE.magic[3] = 'E';
 
-  toc_table.OBJE.offset = ofs.tellp();
+  toc_table.OBJE.offset = writer.tell();
 
-  {
-    // fill class and property tables
-    // iterating object_map here works, because std::map is ordered by key
-    for (const auto &[obj_idx, it] : object_map | std::views::enumerate) {
-      const auto &obj = it.second;
-      auto clas_it = gen_clas_items.find(obj.class_name);
-      if (clas_it == gen_clas_items.end()) {
-        gen_clas_table.push_back(obj.class_name);
-        gen_clas_items.insert({obj.class_name, gen_clas_table.size() - 1});
-        uint32_t class_idx = gen_clas_table.size() - 1;
-        gen_property_table.emplace_back();
-        for (auto &property : obj.properties) {
-          gen_property_table[class_idx].properties.insert(
-              {property->property_name, 0});
-          gen_property_set.insert({property->property_name, class_idx});
-        }
-      } else {
-        for (auto &property : obj.properties) {
-          if (!gen_property_set.contains(
-                  {property->property_name, clas_it->second})) {
-            gen_property_set.insert({property->property_name, clas_it->second});
-            gen_property_table[clas_it->second].properties.insert(
-                {property->property_name, 0});
-          }
-        }
-      }
-
-      if (obj.is_top_object) {
-        gen_topo_table.push_back(obj_idx);
-      }
+  // the schema is up to date, so only the per save tables are filled here
+  for (const auto &[obj_idx, it] : object_map | std::views::enumerate) {
+    const auto &obj = it.second;
+    gen_object_classes.push_back(schema.find_class(obj.class_name));
 
-      if (obj.export_path.size()) {
-        get_or_add_expr(obj.export_path, obj_idx);
-      }
+    if (obj.is_top_object) {
+      gen_topo_table.push_back(obj_idx);
     }
-    // now generate property indices
-    for (auto &&[clas_idx, clas] : gen_property_table | std::views::enumerate) {
-      for (auto &[prop_name, prop_idx] : clas.properties) {
-        gen_property_items.push_back({prop_name, clas_idx});
-        prop_idx = gen_property_items.size() - 1;
-      }
+
+    if (obj.export_path.size()) {
+      add_expr(obj.export_path, obj_idx);
     }
   }
 
   // write OBJE
-  // writing the properties also fills the string table
-  spdlog::debug("writing objects @0x{:02X}", (uint32_t)ofs.tellp());
-  for (const auto &[obj_idx, it] : object_map | std::views::enumerate) {
-    const auto &obj = it.second;
-    uint32_t class_idx = gen_clas_items[obj.class_name];
-    spdlog::debug("writing classidx @0x{:02X} {}", (uint32_t)ofs.tellp(),
-                  class_idx);
-    ofs.write(reinterpret_cast<char *>(&class_idx), sizeof(class_idx));
-
-    for (auto &property : obj.properties) {
-      uint32_t property_idx = gen_property_table[gen_clas_items[obj.class_name]]
-                                  .properties[property->property_name];
-      property->property_idx = property_idx;
-      spdlog::debug("writing propidx @0x{:02X} {}", (uint32_t)ofs.tellp(),
-                    property_idx);
-      ofs.write(reinterpret_cast<char *>(&property_idx), sizeof(property_idx));
-      uint32_t ndf_type = property->property_type;
-      spdlog::debug("writing ndf_type @0x{:02X} {}", (uint32_t)ofs.tellp(),
-                    ndf_type);
-      ofs.write(reinterpret_cast<char *>(&ndf_type), sizeof(ndf_type));
-      property->to_ndfbin(this, ofs);
-    }
-    // write last property
-    uint32_t property_idx = 2880154539;
-    ofs.write(reinterpret_cast<char *>(&property_idx), sizeof(property_idx));
-  }
-
-  toc_table.OBJE.size = (uint32_t)ofs.tellp() - toc_table.OBJE.offset;
+  // writing the properties also fills the string and import tables
+  spdlog::debug("writing objects @0x{:02X}", (uint32_t)writer.tell());
+  save_ndfbin_objects(writer);
+
+  toc_table.OBJE.size = (uint32_t)writer.tell() - toc_table.OBJE.offset;
 
   // write TOPO
   toc_table.TOPO.magic[0] = 'T';
@@ -522,14 +819,14 @@ void NDF::save_as_ndfbin_stream(std::ostream &ofs) {
   toc_table.TOPO.magic[2] = 'P';
   toc_table.TOPO.magic[3] = 'O';
 
-  toc_table.TOPO.offset = ofs.tellp();
+  toc_table.TOPO.offset = writer.tell();
 
-  spdlog::debug("writing topo @0x{:02X}", (uint32_t)ofs.tellp());
+  spdlog::debug("writing topo @0x{:02X}", (uint32_t)writer.tell());
   for (uint32_t obj_idx : gen_topo_table) {
-    ofs.write(reinterpret_cast<char *>(&obj_idx), sizeof(obj_idx));
+    writer.write(obj_idx);
   }
 
-  toc_table.TOPO.size = (uint32_t)ofs.tellp() - toc_table.TOPO.offset;
+  toc_table.TOPO.size = (uint32_t)writer.tell() - toc_table.TOPO.offset;
 
   // write CHNK
   toc_table.CHNK.magic[0] = 'C';
@@ -537,14 +834,14 @@ void NDF::save_as_ndfbin_stream(std::ostream &ofs) {
   toc_table.CHNK.magic[2] = 'N';
   toc_table.CHNK.magic[3] = 'K';
 
-  toc_table.CHNK.offset = ofs.tellp();
+  toc_table.CHNK.offset = writer.tell();
 
-  spdlog::debug("writing chunk @0x{:02X}", (uint32_t)ofs.tellp());
+  spdlog::debug("writing chunk @0x{:02X}", (uint32_t)writer.tell());
 
   uint32_t object_count = object_map.size();
-  ofs.write(reinterpret_cast<char *>(&object_count), sizeof(object_count));
+  writer.write(object_count);
 
-  toc_table.CHNK.size = (uint32_t)ofs.tellp() - toc_table.CHNK.offset;
+  toc_table.CHNK.size = (uint32_t)writer.tell() - toc_table.CHNK.offset;
 
   // write CLAS
   toc_table.CLAS.magic[0] = 'C';
@@ -552,15 +849,13 @@ void NDF::save_as_ndfbin_stream(std::ostream &ofs) {
   toc_table.CLAS.magic[2] = 'A';
   toc_table.CLAS.magic[3] = 'S';
 
-  toc_table.CLAS.offset = ofs.tellp();
+  toc_table.CLAS.offset = writer.tell();
 
-  for (const auto &clas : gen_clas_table) {
-    uint32_t length = clas.size();
-    ofs.write(reinterpret_cast<char *>(&length), sizeof(length));
-    ofs.write(clas.data(), length * sizeof(char));
+  for (const auto &clas : schema.classes.items()) {
+    writer.write_length_string(clas);
   }
 
-  toc_table.CLAS.size = (uint32_t)ofs.tellp() - toc_table.CLAS.offset;
+  toc_table.CLAS.size = (uint32_t)writer.tell() - toc_table.CLAS.offset;
 
   // write PROP
   toc_table.PROP.magic[0] = 'P';
@@ -568,19 +863,17 @@ void NDF::save_as_ndfbin_stream(std::ostream &ofs) {
   toc_table.PROP.magic[2] = 'O';
   toc_table.PROP.magic[3] = 'P';
 
-  toc_table.PROP.offset = ofs.tellp();
+  toc_table.PROP.offset = writer.tell();
 
-  spdlog::debug("writing properties @0x{:02X}", (uint32_t)ofs.tellp());
-  for (const auto &[prop_name, class_idx] : gen_property_items) {
-    uint32_t length = prop_name.size();
-    ofs.write(reinterpret_cast<char *>(&length), sizeof(length));
-    ofs.write(prop_name.data(), length * sizeof(char));
+  spdlog::debug("writing properties @0x{:02X}", (uint32_t)writer.tell());
+  for (const auto &[prop_name, class_idx] : schema.properties) {
+    writer.write_length_string(prop_name);
     uint32_t class_index = class_idx;
-    ofs.write(reinterpret_cast<char *>(&class_index), sizeof(class_index));
+    writer.write(class_index);
     spdlog::debug("writing prop {} {}", prop_name, class_index);
   }
 
-  toc_table.PROP.size = (uint32_t)ofs.tellp() - toc_table.PROP.offset;
+  toc_table.PROP.size = (uint32_t)writer.tell() - toc_table.PROP.offset;
 
   // write STRG
   toc_table.STRG.magic[0] = 'S';
@@ -588,16 +881,14 @@ void NDF::save_as_ndfbin_stream(std::ostream &ofs) {
   toc_table.STRG.magic[2] = 'R';
   toc_table.STRG.magic[3] = 'G';
 
-  toc_table.STRG.offset = ofs.tellp();
+  toc_table.STRG.offset = writer.tell();
 
-  spdlog::debug("writing strings @0x{:02X}", (uint32_t)ofs.tellp());
-  for (const auto &str : gen_string_items) {
-    uint32_t length = str.size();
-    ofs.write(reinterpret_cast<char *>(&length), sizeof(length));
-    ofs.write(str.data(), length * sizeof(char));
+  spdlog::debug("writing strings @0x{:02X}", (uint32_t)writer.tell());
+  for (const auto &str : gen_strings.items()) {
+    writer.write_length_string(str);
   }
 
-  toc_table.STRG.size = (uint32_t)ofs.tellp() - toc_table.STRG.offset;
+  toc_table.STRG.size = (uint32_t)writer.tell() - toc_table.STRG.offset;
 
   // write TRAN
   toc_table.TRAN.magic[0] = 'T';
@@ -605,16 +896,14 @@ void NDF::save_as_ndfbin_stream(std::ostream &ofs) {
   toc_table.TRAN.magic[2] = 'A';
   toc_table.TRAN.magic[3] = 'N';
 
-  toc_table.TRAN.offset = ofs.tellp();
+  toc_table.TRAN.offset = writer.tell();
 
-  spdlog::debug("writing tran @0x{:02X}", (uint32_t)ofs.tellp());
-  for (const auto &tran : gen_tran_table) {
-    uint32_t length = tran.size();
-    ofs.write(reinterpret_cast<char *>(&length), sizeof(length));
-    ofs.write(tran.data(), length * sizeof(char));
+  spdlog::debug("writing tran @0x{:02X}", (uint32_t)writer.tell());
+  for (const auto &tran : gen_trans.items()) {
+    writer.write_length_string(tran);
   }
 
-  toc_table.TRAN.size = (uint32_t)ofs.tellp() - toc_table.TRAN.offset;
+  toc_table.TRAN.size = (uint32_t)writer.tell() - toc_table.TRAN.offset;
 
   // write IMPR
   toc_table.IMPR.magic[0] = 'I';
@@ -622,12 +911,12 @@ void NDF::save_as_ndfbin_stream(std::ostream &ofs) {
   toc_table.IMPR.magic[2] = 'P';
   toc_table.IMPR.magic[3] = 'R';
 
-  toc_table.IMPR.offset = ofs.tellp();
+  toc_table.IMPR.offset = writer.tell();
 
-  spdlog::debug("writing impr @0x{:02X}", (uint32_t)ofs.tellp());
-  save_ndfbin_imprs(gen_import_table, ofs);
+  spdlog::debug("writing impr @0x{:02X}", (uint32_t)writer.tell());
+  gen_import_paths.write_ndfbin(writer);
 
-  toc_table.IMPR.size = (uint32_t)ofs.tellp() - toc_table.IMPR.offset;
+  toc_table.IMPR.size = (uint32_t)writer.tell() - toc_table.IMPR.offset;
 
   // write EXPR
   toc_table.EXPR.magic[0] = 'E';
@@ -635,19 +924,32 @@ void NDF::save_as_ndfbin_stream(std::ostream &ofs) {
   toc_table.EXPR.magic[2] = 'P';
   toc_table.EXPR.magic[3] = 'R';
 
-  toc_table.EXPR.offset = ofs.tellp();
+  toc_table.EXPR.offset = writer.tell();
 
-  spdlog::debug("writing expr @0x{:02X}", (uint32_t)ofs.tellp());
-  save_ndfbin_imprs(gen_export_table, ofs);
+  spdlog::debug("writing expr @0x{:02X}", (uint32_t)writer.tell());
+  gen_export_paths.write_ndfbin(writer);
 
-  toc_table.EXPR.size = (uint32_t)ofs.tellp() - toc_table.EXPR.offset;
+  toc_table.EXPR.size = (uint32_t)writer.tell() - toc_table.EXPR.offset;
 
   // write TOC0 Header
-  header.toc0offset = (uint32_t)ofs.tellp();
-  ofs.write(reinterpret_cast<char *>(&toc_table), sizeof(toc_table));
+  header.toc0offset = (uint32_t)writer.tell();
+  writer.write(toc_table);
 
   // rewrite header
-  header.size = (uint32_t)ofs.tellp() - 40;
-  ofs.seekp(0);
-  ofs.write(reinterpret_cast<char *>(&header), sizeof(header));
+  header.size = (uint32_t)writer.tell() - 40;
+  if (!compressed) {
+    writer.patch(0, header);
+    writer.write_to(ofs);
+    return;
+  }
+
+  header.compressed = compressed_flag;
+  auto body = writer.data().subspan(sizeof(NDFBinHeader));
+  // deflate usually shrinks ndfbin to less than a third
+  NDFBinWriter compressed_writer(body.size() / 3);
+  compressed_writer.write(header);
+  compressed_writer.write<uint32_t>(header.size);
+  ndfbin_deflate(body, compressed_writer,
+                 std::max(1u, std::thread::hardware_concurrency()));
+  compressed_writer.write_to(ofs);
 }
@@ -0,0 +1,122 @@
+#include "ndfbin_reader.hpp"
+
+#include <iterator>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+NDFBinBuffer::~NDFBinBuffer() {
+  if (!m_mapped) {
+    return;
+  }
+#ifdef _WIN32
+  UnmapViewOfFile(m_data);
+  CloseHandle(m_mapping);
+  CloseHandle(m_file);
+#else
+  munmap(const_cast<char *>(m_data), m_size);
+#endif
+}
+
+std::unique_ptr<NDFBinBuffer> NDFBinBuffer::map_file(fs::path path) {
+  auto ret = std::make_unique<NDFBinBuffer>();
+#ifdef _WIN32
+  HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error("Failed to open file " + path.string());
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    throw std::runtime_error("Failed to get size of file " + path.string());
+  }
+  if (size.QuadPart == 0) {
+    // empty files can't be mapped, the header check will fail later on
+    CloseHandle(file);
+    return ret;
+  }
+  HANDLE mapping =
+      CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    CloseHandle(file);
+    throw std::runtime_error("Failed to map file " + path.string());
+  }
+  void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (data == nullptr) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    throw std::runtime_error("Failed to map file " + path.string());
+  }
+  ret->m_file = file;
+  ret->m_mapping = mapping;
+  ret->m_data = static_cast<const char *>(data);
+  ret->m_size = static_cast<size_t>(size.QuadPart);
+#else
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    throw std::runtime_error("Failed to open file " + path.string());
+  }
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    close(fd);
+    throw std::runtime_error("Failed to get size of file " + path.string());
+  }
+  if (st.st_size == 0) {
+    // empty files can't be mapped, the header check will fail later on
+    close(fd);
+    return ret;
+  }
+  void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping keeps its own reference to the file
+  close(fd);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error("Failed to map file " + path.string());
+  }
+  ret->m_data = static_cast<const char *>(data);
+  ret->m_size = static_cast<size_t>(st.st_size);
+#endif
+  ret->m_path = std::move(path);
+  ret->m_mapped = true;
+  return ret;
+}
+
+std::unique_ptr<NDFBinBuffer> NDFBinBuffer::read_stream(std::istream &stream) {
+  std::vector<char> bytes;
+  // seekable streams can be read in one go, everything else is read until EOF
+  auto begin = stream.tellg();
+  if (begin != std::streampos(-1) && stream.seekg(0, std::ios::end)) {
+    auto end = stream.tellg();
+    stream.seekg(begin);
+    bytes.resize(static_cast<size_t>(end - begin));
+    stream.read(bytes.data(), bytes.size());
+    bytes.resize(stream.gcount());
+  } else {
+    stream.clear();
+    bytes.assign(std::istreambuf_iterator<char>(stream),
+                 std::istreambuf_iterator<char>());
+  }
+  return from_bytes(std::move(bytes));
+}
+
+std::unique_ptr<NDFBinBuffer>
+NDFBinBuffer::from_bytes(std::vector<char> bytes) {
+  auto ret = std::make_unique<NDFBinBuffer>();
+  ret->m_heap = std::move(bytes);
+  ret->m_data = ret->m_heap.data();
+  ret->m_size = ret->m_heap.size();
+  return ret;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <istream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// owns the raw bytes of a ndfbin file, either as a read-only memory mapping of
+// the file or as a heap buffer filled from a stream.
+// views into the buffer (e.g. the string tables of NDF) stay valid as long as
+// the buffer lives.
+class NDFBinBuffer {
+private:
+  const char *m_data = nullptr;
+  size_t m_size = 0;
+  std::vector<char> m_heap;
+  fs::path m_path;
+#ifdef _WIN32
+  void *m_file = nullptr;
+  void *m_mapping = nullptr;
+#endif
+  bool m_mapped = false;
+
+public:
+  NDFBinBuffer() = default;
+  NDFBinBuffer(const NDFBinBuffer &) = delete;
+  NDFBinBuffer &operator=(const NDFBinBuffer &) = delete;
+  ~NDFBinBuffer();
+
+  static std::unique_ptr<NDFBinBuffer> map_file(fs::path path);
+  static std::unique_ptr<NDFBinBuffer> read_stream(std::istream &stream);
+  static std::unique_ptr<NDFBinBuffer> from_bytes(std::vector<char> bytes);
+
+  std::span<const char> data() const { return {m_data, m_size}; }
+  size_t size() const { return m_size; }
+  bool is_mapped() const { return m_mapped; }
+  // the file passed to map_file, empty for heap buffers
+  const fs::path &mapped_path() const { return m_path; }
+};
+
+// bounds checked cursor over a span of ndfbin data, every read throws a
+// std::runtime_error instead of reading past the end.
+class NDFBinReader {
+private:
+  std::span<const char> m_data;
+  size_t m_pos = 0;
+
+  [[noreturn]] void out_of_bounds(size_t count) const {
+    throw std::runtime_error(
+        std::format("ndfbin: reading {} bytes @0x{:02X} exceeds size 0x{:02X}",
+                    count, m_pos, m_data.size()));
+  }
+
+public:
+  NDFBinReader() = default;
+  explicit NDFBinReader(std::span<const char> data) : m_data(data) {}
+
+  // throws if less than count bytes are left, e.g. before allocating memory
+  // for a length read from the file
+  void require(size_t count) const {
+    if (count > m_data.size() - m_pos) {
+      out_of_bounds(count);
+    }
+  }
+
+  size_t tell() const { return m_pos; }
+  size_t size() const { return m_data.size(); }
+  size_t remaining() const { return m_data.size() - m_pos; }
+  bool at_end() const { return m_pos >= m_data.size(); }
+  const char *current() const { return m_data.data() + m_pos; }
+  std::span<const char> data() const { return m_data; }
+
+  void seek(size_t pos) {
+    if (pos > m_data.size()) {
+      throw std::runtime_error(std::format(
+          "ndfbin: seek to 0x{:02X} exceeds size 0x{:02X}", pos, m_data.size()));
+    }
+    m_pos = pos;
+  }
+  void skip(size_t count) {
+    require(count);
+    m_pos += count;
+  }
+
+  // returns a new reader only spanning [offset, offset + size), used for the
+  // TOC sections
+  NDFBinReader sub(size_t offset, size_t size) const {
+    if (offset > m_data.size() || size > m_data.size() - offset) {
+      throw std::runtime_error(std::format(
+          "ndfbin: section 0x{:02X}+0x{:02X} exceeds size 0x{:02X}", offset,
+          size, m_data.size()));
+    }
+    return NDFBinReader(m_data.subspan(offset, size));
+  }
+
+  template <typename T> T read() {
+    static_assert(std::is_trivially_copyable_v<T>);
+    require(sizeof(T));
+    T ret;
+    std::memcpy(&ret, m_data.data() + m_pos, sizeof(T));
+    m_pos += sizeof(T);
+    return ret;
+  }
+
+  template <typename T> void read_into(T *dst, size_t count) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (count > remaining() / sizeof(T)) {
+      out_of_bounds(count * sizeof(T));
+    }
+    std::memcpy(dst, m_data.data() + m_pos, count * sizeof(T));
+    m_pos += count * sizeof(T);
+  }
+
+  std::string_view read_string_view(size_t length) {
+    require(length);
+    std::string_view ret(m_data.data() + m_pos, length);
+    m_pos += length;
+    return ret;
+  }
+
+  // strings in CLAS/STRG/TRAN/PROP are stored with an uint32_t length prefix
+  std::string_view read_length_string() {
+    uint32_t length = read<uint32_t>();
+    return read_string_view(length);
+  }
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+// a single property value as seen by NDFBinVisitor, only valid during the
+// callback. all views point into the ndfbin buffer or the tables of the file.
+struct NDFBinValue {
+  // NDFPropertyType, ObjectReference and ImportReference are both 0x9
+  uint32_t type = 0;
+  // raw payload of the value, e.g. 4 bytes for Int32, 12 bytes for F32_vec3
+  // or the UTF-16 data of a WideString
+  std::span<const char> data;
+  // resolved value of String, PathReference and ImportReference
+  std::string_view string;
+  bool is_object_reference = false;
+  bool is_import_reference = false;
+  uint32_t object_index = 0;
+
+  // reinterprets the payload, e.g. as<float>() for Float32 or
+  // as<std::array<float, 3>>() for F32_vec3
+  template <typename T> T as() const {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (sizeof(T) != data.size()) {
+      throw std::runtime_error("NDFBinValue: size mismatch");
+    }
+    T ret;
+    std::memcpy(&ret, data.data(), sizeof(T));
+    return ret;
+  }
+};
+
+// callbacks for walking a ndfbin file without building NDFObject/NDFProperty
+// instances, see NDF::visit_ndfbin.
+// items of lists/maps/pairs are named like in NDFObject ("ListItem", "Key",
+// "Value", "First", "Second").
+struct NDFBinVisitor {
+  virtual ~NDFBinVisitor() = default;
+  // return false to skip the properties of this object
+  virtual bool begin_object(uint32_t, std::string_view) { return true; }
+  virtual void end_object(uint32_t) {}
+  // called for every non-container value
+  virtual void property(std::string_view, const NDFBinValue &) {}
+  virtual void begin_list(std::string_view, uint32_t) {}
+  virtual void end_list(std::string_view) {}
+  virtual void begin_map(std::string_view, uint32_t) {}
+  virtual void end_map(std::string_view) {}
+  virtual void begin_pair(std::string_view) {}
+  virtual void end_pair(std::string_view) {}
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// strings or imports referenced by a chunk of objects that is written on its
+// own thread. the chunk only contains provisional indices into items, which
+// are rewritten to the indices of the global tables when merging the chunks.
+struct NDFBinLocalTable {
+  std::vector<std::string_view> items;
+  std::unordered_map<std::string_view, uint32_t> indices;
+  // buffer positions of the provisional indices
+  std::vector<size_t> positions;
+
+  uint32_t get_or_add(std::string_view str, size_t position) {
+    positions.push_back(position);
+    auto [it, inserted] = indices.try_emplace(str, items.size());
+    if (inserted) {
+      items.push_back(str);
+    }
+    return it->second;
+  }
+};
+
+struct NDFBinLocalSymbols {
+  NDFBinLocalTable strings;
+  NDFBinLocalTable imports;
+};
+
+// serialises a ndfbin file into one growable buffer, offsets that are only
+// known later (header, TOC, IMPR/EXPR offset tables) are patched in place and
+// the finished file is written with a single call.
+class NDFBinWriter {
+private:
+  std::vector<char> m_data;
+
+public:
+  // set while writing a chunk of objects in parallel
+  NDFBinLocalSymbols *local_symbols = nullptr;
+
+  NDFBinWriter() = default;
+  explicit NDFBinWriter(size_t capacity) { m_data.reserve(capacity); }
+
+  size_t tell() const { return m_data.size(); }
+  std::span<const char> data() const { return m_data; }
+  void reserve(size_t capacity) { m_data.reserve(capacity); }
+
+  // returns count zero filled bytes at the end of the buffer, only valid
+  // until the next write
+  std::span<char> append(size_t count) {
+    size_t pos = m_data.size();
+    m_data.resize(pos + count);
+    return {m_data.data() + pos, count};
+  }
+
+  void write_bytes(const void *data, size_t count) {
+    if (count > 0) {
+      std::memcpy(append(count).data(), data, count);
+    }
+  }
+
+  template <typename T> void write(const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    write_bytes(&value, sizeof(T));
+  }
+
+  // strings in CLAS/STRG/TRAN/PROP are stored with an uint32_t length prefix
+  void write_length_string(std::string_view str) {
+    write<uint32_t>(str.size());
+    write_bytes(str.data(), str.size());
+  }
+
+  // overwrites already written bytes at pos
+  template <typename T> void patch(size_t pos, const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (pos > m_data.size() || sizeof(T) > m_data.size() - pos) {
+      throw std::runtime_error(std::format(
+          "ndfbin: patching {} bytes @0x{:02X} exceeds size 0x{:02X}",
+          sizeof(T), pos, m_data.size()));
+    }
+    std::memcpy(m_data.data() + pos, &value, sizeof(T));
+  }
+
+  void write_to(std::ostream &stream) const {
+    stream.write(m_data.data(), m_data.size());
+  }
+};
@@ -0,0 +1,158 @@
+#include "ndfbin_zlib.hpp"
+#include "ndfbin_writer.hpp"
+
+#include <spdlog/spdlog.h>
+// next_in is a pointer to const then
+#define ZLIB_CONST
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <format>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// zlib counts in uInt, larger spans are fed in pieces
+static constexpr size_t max_zlib_chunk = std::numeric_limits<uInt>::max();
+
+void ndfbin_inflate(std::span<const char> in, std::span<char> out) {
+  z_stream stream = {};
+  if (inflateInit(&stream) != Z_OK) {
+    throw std::runtime_error("ndfbin: inflateInit failed");
+  }
+  stream.next_in = reinterpret_cast<const Bytef *>(in.data());
+  stream.next_out = reinterpret_cast<Bytef *>(out.data());
+  size_t in_left = in.size();
+  size_t out_left = out.size();
+  int ret = Z_OK;
+  while (ret == Z_OK) {
+    if (stream.avail_in == 0) {
+      stream.avail_in = std::min(in_left, max_zlib_chunk);
+      in_left -= stream.avail_in;
+    }
+    if (stream.avail_out == 0) {
+      stream.avail_out = std::min(out_left, max_zlib_chunk);
+      out_left -= stream.avail_out;
+    }
+    ret = inflate(&stream, Z_NO_FLUSH);
+  }
+  bool out_full = stream.avail_out == 0 && out_left == 0;
+  inflateEnd(&stream);
+  if (ret == Z_STREAM_END && out_full) {
+    return;
+  }
+  if (ret == Z_STREAM_END || out_full) {
+    throw std::runtime_error("ndfbin: inflated size doesn't match the header");
+  }
+  throw std::runtime_error(
+      std::format("ndfbin: inflate failed ({})",
+                  ret == Z_BUF_ERROR ? "truncated data" : "invalid data"));
+}
+
+// one chunk of the input, deflated as raw deflate blocks ending on a byte
+// boundary, so the chunks can be concatenated
+struct NDFBinDeflateChunk {
+  size_t begin = 0;
+  size_t end = 0;
+  std::vector<char> data;
+  uLong adler = 0;
+};
+
+static void deflate_chunk(std::span<const char> in, NDFBinDeflateChunk &chunk,
+                          bool last) {
+  // 32 KiB is the deflate window, so priming with more doesn't help
+  constexpr size_t dictionary_size = 32 * 1024;
+
+  z_stream stream = {};
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error("ndfbin: deflateInit failed");
+  }
+  if (chunk.begin > 0) {
+    size_t dictionary = std::min(chunk.begin, dictionary_size);
+    deflateSetDictionary(
+        &stream,
+        reinterpret_cast<const Bytef *>(in.data() + chunk.begin - dictionary),
+        dictionary);
+  }
+
+  size_t size = chunk.end - chunk.begin;
+  const char *data = in.data() + chunk.begin;
+  chunk.adler = adler32(adler32(0, nullptr, 0),
+                        reinterpret_cast<const Bytef *>(data), size);
+  // the bound doesn't include the empty block of Z_SYNC_FLUSH
+  chunk.data.resize(deflateBound(&stream, size) + 16);
+  stream.next_in = reinterpret_cast<const Bytef *>(data);
+  stream.avail_in = size;
+  stream.next_out = reinterpret_cast<Bytef *>(chunk.data.data());
+  stream.avail_out = chunk.data.size();
+  int ret = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+  bool ok = last ? ret == Z_STREAM_END : ret == Z_OK && stream.avail_in == 0;
+  chunk.data.resize(stream.total_out);
+  deflateEnd(&stream);
+  if (!ok) {
+    throw std::runtime_error("ndfbin: deflate failed");
+  }
+}
+
+void ndfbin_deflate(std::span<const char> in, NDFBinWriter &writer,
+                    size_t thread_count) {
+  // same block size as pigz, large enough that priming and flushing every
+  // chunk barely costs anything
+  constexpr size_t chunk_size = 128 * 1024;
+  static_assert(chunk_size < max_zlib_chunk);
+
+  std::vector<NDFBinDeflateChunk> chunks(
+      std::max<size_t>(1, (in.size() + chunk_size - 1) / chunk_size));
+  for (size_t i = 0; i < chunks.size(); i++) {
+    chunks[i].begin = std::min(in.size(), i * chunk_size);
+    chunks[i].end = std::min(in.size(), chunks[i].begin + chunk_size);
+  }
+
+  thread_count = std::clamp<size_t>(thread_count, 1, chunks.size());
+  spdlog::debug("deflating {} bytes in {} chunks on {} threads", in.size(),
+                chunks.size(), thread_count);
+  if (thread_count == 1) {
+    for (size_t i = 0; i < chunks.size(); i++) {
+      deflate_chunk(in, chunks[i], i + 1 == chunks.size());
+    }
+  } else {
+    std::atomic<size_t> next = 0;
+    std::vector<std::exception_ptr> errors(thread_count);
+    {
+      std::vector<std::jthread> threads;
+      for (size_t t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t]() {
+          try {
+            for (size_t i = next++; i < chunks.size(); i = next++) {
+              deflate_chunk(in, chunks[i], i + 1 == chunks.size());
+            }
+          } catch (...) {
+            errors[t] = std::current_exception();
+          }
+        });
+      }
+    }
+    for (auto &error : errors) {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+  }
+
+  // zlib header for the default level, deflate with a 32 KiB window
+  writer.write<uint8_t>(0x78);
+  writer.write<uint8_t>(0x9C);
+  uLong adler = adler32(0, nullptr, 0);
+  for (const auto &chunk : chunks) {
+    writer.write_bytes(chunk.data.data(), chunk.data.size());
+    adler = adler32_combine(adler, chunk.adler, chunk.end - chunk.begin);
+  }
+  // the checksum is stored big endian
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    writer.write<uint8_t>((adler >> shift) & 0xFF);
+  }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+class NDFBinWriter;
+
+// zlib streams used for the body of compressed ndfbin files
+
+// inflates the zlib stream in into out, out has to be exactly the size of the
+// uncompressed data
+void ndfbin_inflate(std::span<const char> in, std::span<char> out);
+
+// compresses in as a single zlib stream and appends it to writer.
+// the data is split into chunks that are deflated independently on up to
+// thread_count threads (like pigz), every chunk is primed with the 32 KiB
+// preceding it, so the ratio stays close to a serial deflate. the result is a
+// normal zlib stream any inflate can read.
+void ndfbin_deflate(std::span<const char> in, NDFBinWriter &writer,
+                    size_t thread_count);
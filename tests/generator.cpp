@@ -49,8 +49,8 @@ std::unique_ptr<NDFProperty> ndf_generator::gen_random_string(int idx) {
 }
 
 void ndf_generator::add_random_string(NDFObject &obj) {
-  auto prop = gen_random_string(obj.properties.size());
-  obj.properties.push_back(std::move(prop));
+  auto prop = gen_random_string(obj.properties().size());
+  obj.add_property(std::move(prop));
 }
 
 std::unique_ptr<NDFProperty> ndf_generator::gen_random_uint8(int idx) {
@@ -63,8 +63,8 @@ std::unique_ptr<NDFProperty> ndf_generator::gen_random_uint8(int idx) {
 }
 
 void ndf_generator::add_random_uint8(NDFObject &obj) {
-  auto prop = gen_random_uint8(obj.properties.size());
-  obj.properties.push_back(std::move(prop));
+  auto prop = gen_random_uint8(obj.properties().size());
+  obj.add_property(std::move(prop));
 }
 
 std::unique_ptr<NDFProperty> ndf_generator::gen_random_uint16(int idx) {
@@ -77,8 +77,8 @@ std::unique_ptr<NDFProperty> ndf_generator::gen_random_uint16(int idx) {
 }
 
 void ndf_generator::add_random_uint16(NDFObject &obj) {
-  auto prop = gen_random_uint16(obj.properties.size());
-  obj.properties.push_back(std::move(prop));
+  auto prop = gen_random_uint16(obj.properties().size());
+  obj.add_property(std::move(prop));
 }
 
 std::unique_ptr<NDFProperty> ndf_generator::gen_random_uint32(int idx) {
@@ -91,8 +91,8 @@ std::unique_ptr<NDFProperty> ndf_generator::gen_random_uint32(int idx) {
 }
 
 void ndf_generator::add_random_uint32(NDFObject &obj) {
-  auto prop = gen_random_uint32(obj.properties.size());
-  obj.properties.push_back(std::move(prop));
+  auto prop = gen_random_uint32(obj.properties().size());
+  obj.add_property(std::move(prop));
 }
 
 std::unique_ptr<NDFProperty> ndf_generator::gen_random_int32(int idx) {
@@ -105,8 +105,8 @@ std::unique_ptr<NDFProperty> ndf_generator::gen_random_int32(int idx) {
 }
 
 void ndf_generator::add_random_int32(NDFObject &obj) {
-  auto prop = gen_random_uint32(obj.properties.size());
-  obj.properties.push_back(std::move(prop));
+  auto prop = gen_random_uint32(obj.properties().size());
+  obj.add_property(std::move(prop));
 }
 
 std::unique_ptr<NDFProperty> ndf_generator::gen_random_list(int idx) {
@@ -118,14 +118,14 @@ std::unique_ptr<NDFProperty> ndf_generator::gen_random_list(int idx) {
   for (int i = 0; i < 10; i++) {
     auto item = gen_random_uint32(-1);
     item->property_name = "ListItem";
-    prop->values.push_back(std::move(item));
+    prop->values().push_back(std::move(item));
   }
   return prop;
 }
 
 void ndf_generator::add_random_list(NDFObject &obj) {
-  auto prop = gen_random_list(obj.properties.size());
-  obj.properties.push_back(std::move(prop));
+  auto prop = gen_random_list(obj.properties().size());
+  obj.add_property(std::move(prop));
 }
 
 std::unique_ptr<NDFProperty> ndf_generator::gen_random_map(int idx) {
@@ -139,14 +139,14 @@ std::unique_ptr<NDFProperty> ndf_generator::gen_random_map(int idx) {
     key->property_name = "Key";
     auto value = gen_random_int32(-1);
     value->property_name = "Value";
-    prop->values.push_back({std::move(key), std::move(value)});
+    prop->values().push_back({std::move(key), std::move(value)});
   }
   return prop;
 }
 
 void ndf_generator::add_random_map(NDFObject &obj) {
-  auto prop = gen_random_map(obj.properties.size());
-  obj.properties.push_back(std::move(prop));
+  auto prop = gen_random_map(obj.properties().size());
+  obj.add_property(std::move(prop));
 }
 
 std::unique_ptr<NDFProperty>
@@ -161,8 +161,8 @@ ndf_generator::gen_object_reference(int idx, std::string ref) {
 }
 
 void ndf_generator::add_object_reference(NDFObject &obj, std::string ref) {
-  auto prop = gen_object_reference(obj.properties.size(), ref);
-  obj.properties.push_back(std::move(prop));
+  auto prop = gen_object_reference(obj.properties().size(), ref);
+  obj.add_property(std::move(prop));
 }
 
 std::unique_ptr<NDFProperty>
@@ -177,8 +177,8 @@ ndf_generator::gen_import_reference(int idx, std::string ref) {
 }
 
 void ndf_generator::add_import_reference(NDFObject &obj, std::string ref) {
-  auto prop = gen_import_reference(obj.properties.size(), ref);
-  obj.properties.push_back(std::move(prop));
+  auto prop = gen_import_reference(obj.properties().size(), ref);
+  obj.add_property(std::move(prop));
 }
 
 std::unique_ptr<NDFProperty> ndf_generator::gen_random_property(int idx) {
@@ -210,8 +210,8 @@ std::unique_ptr<NDFProperty> ndf_generator::gen_random_property(int idx) {
 }
 
 void ndf_generator::add_random_property(NDFObject &obj) {
-  auto prop = gen_random_property(obj.properties.size());
-  obj.properties.push_back(std::move(prop));
+  auto prop = gen_random_property(obj.properties().size());
+  obj.add_property(std::move(prop));
 }
 
 std::vector<std::unique_ptr<NDFProperty>>
@@ -258,9 +258,9 @@ ndf_generator::gen_random_properties(int idx, int count) {
 }
 
 void ndf_generator::add_random_properties(NDFObject &obj, int count) {
-  auto props = gen_random_properties(obj.properties.size(), count);
+  auto props = gen_random_properties(obj.properties().size(), count);
   for (auto &prop : props) {
-    obj.properties.push_back(std::move(prop));
+    obj.add_property(std::move(prop));
   }
 }
 
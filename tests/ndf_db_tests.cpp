@@ -31,10 +31,11 @@ public:
   }
 };
 
-bool check_property_equality(NDFProperty *prop1, NDFProperty *prop2) {
+bool check_property_equality(const NDFProperty *prop1,
+                             const NDFProperty *prop2) {
   if (prop1->property_name != prop2->property_name) {
-    spdlog::info("name {} differs from {}", prop1->property_name,
-                 prop2->property_name);
+    spdlog::info("name {} differs from {}", prop1->property_name.str(),
+                 prop2->property_name.str());
     return false;
   }
   if (prop1->property_idx != prop2->property_idx) {
@@ -48,75 +49,77 @@ bool check_property_equality(NDFProperty *prop1, NDFProperty *prop2) {
     return false;
   }
   if (prop1->property_type == NDFPropertyType::UInt8) {
-    NDFPropertyUInt8 *p1 = (NDFPropertyUInt8 *)(prop1);
-    NDFPropertyUInt8 *p2 = (NDFPropertyUInt8 *)(prop2);
+    auto *p1 = (const NDFPropertyUInt8 *)(prop1);
+    auto *p2 = (const NDFPropertyUInt8 *)(prop2);
     if (p1->value != p2->value) {
       return false;
     }
   }
   if (prop1->property_type == NDFPropertyType::UInt16) {
-    NDFPropertyUInt16 *p1 = (NDFPropertyUInt16 *)(prop1);
-    NDFPropertyUInt16 *p2 = (NDFPropertyUInt16 *)(prop2);
+    auto *p1 = (const NDFPropertyUInt16 *)(prop1);
+    auto *p2 = (const NDFPropertyUInt16 *)(prop2);
     if (p1->value != p2->value) {
       return false;
     }
   }
   if (prop1->property_type == NDFPropertyType::UInt32) {
-    NDFPropertyUInt32 *p1 = (NDFPropertyUInt32 *)(prop1);
-    NDFPropertyUInt32 *p2 = (NDFPropertyUInt32 *)(prop2);
+    auto *p1 = (const NDFPropertyUInt32 *)(prop1);
+    auto *p2 = (const NDFPropertyUInt32 *)(prop2);
     if (p1->value != p2->value) {
       return false;
     }
   }
   if (prop1->property_type == NDFPropertyType::Int16) {
-    NDFPropertyInt16 *p1 = (NDFPropertyInt16 *)(prop1);
-    NDFPropertyInt16 *p2 = (NDFPropertyInt16 *)(prop2);
+    auto *p1 = (const NDFPropertyInt16 *)(prop1);
+    auto *p2 = (const NDFPropertyInt16 *)(prop2);
     if (p1->value != p2->value) {
       return false;
     }
   }
   if (prop1->property_type == NDFPropertyType::Int32) {
-    NDFPropertyInt32 *p1 = (NDFPropertyInt32 *)(prop1);
-    NDFPropertyInt32 *p2 = (NDFPropertyInt32 *)(prop2);
+    auto *p1 = (const NDFPropertyInt32 *)(prop1);
+    auto *p2 = (const NDFPropertyInt32 *)(prop2);
     if (p1->value != p2->value) {
       return false;
     }
   }
   if (prop1->property_type == NDFPropertyType::String) {
-    NDFPropertyString *p1 = (NDFPropertyString *)(prop1);
-    NDFPropertyString *p2 = (NDFPropertyString *)(prop2);
+    auto *p1 = (const NDFPropertyString *)(prop1);
+    auto *p2 = (const NDFPropertyString *)(prop2);
     if (p1->value != p2->value) {
       return false;
     }
   }
   if (prop1->property_type == NDFPropertyType::WideString) {
-    NDFPropertyWideString *p1 = (NDFPropertyWideString *)(prop1);
-    NDFPropertyWideString *p2 = (NDFPropertyWideString *)(prop2);
+    auto *p1 = (const NDFPropertyWideString *)(prop1);
+    auto *p2 = (const NDFPropertyWideString *)(prop2);
     if (p1->value != p2->value) {
       return false;
     }
   }
   if (prop1->is_import_reference()) {
-    NDFPropertyImportReference *p1 = (NDFPropertyImportReference *)(prop1);
-    NDFPropertyImportReference *p2 = (NDFPropertyImportReference *)(prop2);
+    auto *p1 = (const NDFPropertyImportReference *)(prop1);
+    auto *p2 = (const NDFPropertyImportReference *)(prop2);
     if (p1->import_name != p2->import_name) {
       return false;
     }
   }
   if (prop1->is_object_reference()) {
-    NDFPropertyObjectReference *p1 = (NDFPropertyObjectReference *)(prop1);
-    NDFPropertyObjectReference *p2 = (NDFPropertyObjectReference *)(prop2);
+    auto *p1 = (const NDFPropertyObjectReference *)(prop1);
+    auto *p2 = (const NDFPropertyObjectReference *)(prop2);
     if (p1->object_name != p2->object_name) {
       return false;
     }
   }
   if (prop1->is_list()) {
-    NDFPropertyList *list1 = (NDFPropertyList *)(prop1);
-    NDFPropertyList *list2 = (NDFPropertyList *)(prop2);
-    REQUIRE(list1->values.size() == list2->values.size());
-    for (size_t x = 0; x < list1->values.size(); x++) {
-      if (!check_property_equality(list1->values[x].get(),
-                                   list2->values[x].get())) {
+    auto *list1 = (const NDFPropertyList *)(prop1);
+    auto *list2 = (const NDFPropertyList *)(prop2);
+    // lists loaded from ndfbin may be packed
+    auto items1 = list1->unpacked_values();
+    auto items2 = list2->unpacked_values();
+    REQUIRE(items1.size() == items2.size());
+    for (size_t x = 0; x < items1.size(); x++) {
+      if (!check_property_equality(items1[x].get(), items2[x].get())) {
         return false;
       }
     }
@@ -144,14 +147,14 @@ bool check_object_equality(NDFObject *obj1, NDFObject *obj2) {
                  obj2->is_top_object, obj1->is_top_object);
     return false;
   }
-  if (obj1->properties.size() != obj2->properties.size()) {
+  if (obj1->properties().size() != obj2->properties().size()) {
     spdlog::info("object property counts differ {} should be {}",
-                 obj2->properties.size(), obj1->properties.size());
+                 obj2->properties().size(), obj1->properties().size());
     return false;
   }
-  for (size_t x = 0; x < obj1->properties.size(); x++) {
-    if (!check_property_equality(obj1->properties[x].get(),
-                                 obj2->properties[x].get())) {
+  for (size_t x = 0; x < obj1->properties().size(); x++) {
+    if (!check_property_equality(obj1->properties()[x].get(),
+                                 obj2->properties()[x].get())) {
       return false;
     }
   }
@@ -267,24 +270,24 @@ TEST_CASE_PERSISTENT_FIXTURE(PyFixture, "ndf_db tests", "[ndf_db]") {
     // check reference is changed
     auto db_obj1 = db.get_object(obj1_id);
     REQUIRE(db_obj1.has_value());
-    REQUIRE(db_obj1.value().properties.size() == 5);
-    REQUIRE(db_obj1.value().properties[4]->is_object_reference());
+    REQUIRE(db_obj1.value().properties().size() == 5);
+    REQUIRE(db_obj1.value().properties()[4]->is_object_reference());
     NDFPropertyObjectReference *obj_ref =
-        (NDFPropertyObjectReference *)db_obj1.value().properties[4].get();
+        (NDFPropertyObjectReference *)db_obj1.value().properties()[4].get();
     REQUIRE(obj_ref->object_name == "new_test_object");
     // check the other object reference is not changed
     auto db_obj = db.get_object(obj_id);
     REQUIRE(db_obj.has_value());
-    REQUIRE(db_obj.value().properties.size() == 6);
-    REQUIRE(db_obj.value().properties[4]->is_object_reference());
+    REQUIRE(db_obj.value().properties().size() == 6);
+    REQUIRE(db_obj.value().properties()[4]->is_object_reference());
     NDFPropertyObjectReference *obj_unchanged_ref =
-        (NDFPropertyObjectReference *)db_obj.value().properties[4].get();
+        (NDFPropertyObjectReference *)db_obj.value().properties()[4].get();
     REQUIRE(obj_unchanged_ref->object_name == "test_object");
     // check changed import path
     REQUIRE(db_obj1.value().export_path == "$/test/new_path");
-    REQUIRE(db_obj.value().properties[5]->is_import_reference());
+    REQUIRE(db_obj.value().properties()[5]->is_import_reference());
     NDFPropertyImportReference *import_ref =
-        (NDFPropertyImportReference *)db_obj.value().properties[5].get();
+        (NDFPropertyImportReference *)db_obj.value().properties()[5].get();
     REQUIRE(import_ref->import_name == "$/test/new_path");
   }
   SECTION("insert many objects") {
@@ -351,8 +354,8 @@ TEST_CASE_PERSISTENT_FIXTURE(PyFixture, "ndf_db tests", "[ndf_db]") {
     int ndf_from_bin_id = ndf_from_bin_id_opt.value();
     ndf_from_bin.load_from_ndfbin(files_path / "test.ndfbin");
     spdlog::info("property count {}",
-                 ndf_from_bin.object_map.begin()->second.properties.size());
-    REQUIRE(ndf_from_bin.object_map.begin()->second.properties.size() > 0);
+                 ndf_from_bin.object_map.begin()->second.properties().size());
+    REQUIRE(ndf_from_bin.object_map.begin()->second.properties().size() > 0);
     ndf_from_bin.insert_into_db(&db, ndf_from_bin_id);
 
     NDF ndf_from_xml;
@@ -369,10 +372,9 @@ TEST_CASE_PERSISTENT_FIXTURE(PyFixture, "ndf_db tests", "[ndf_db]") {
     REQUIRE(ndf_from_db_1.object_map.size() == ndf_from_bin.object_map.size());
     auto object_it = ndf_from_bin.object_map.begin();
     while (object_it != ndf_from_bin.object_map.end()) {
-      REQUIRE(ndf_from_bin.object_map.find(object_it->first) !=
-              ndf_from_bin.object_map.end());
-      REQUIRE(check_object_equality(
-          &object_it.value(), &ndf_from_bin.object_map[object_it->first]));
+      auto name = ndf_from_bin.get_object_name(object_it.index());
+      REQUIRE(check_object_equality(&object_it.value(),
+                                    &ndf_from_bin.get_object(name)));
       object_it++;
     }
     ndf_from_db_1.save_as_ndf_xml(output_files_path / "test.ndfbin.xml");
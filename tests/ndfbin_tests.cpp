@@ -0,0 +1,1216 @@
+#include "catch2/catch_all.hpp"
+
+#include "generator.hpp"
+#include "ndf.hpp"
+#include "ndf_property_walker.hpp"
+#include "ndfbin_writer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <utility>
+namespace fs = std::filesystem;
+
+static std::string save_to_string(NDF &ndf, bool incremental = false,
+                                  bool compressed = false) {
+  std::stringstream stream;
+  ndf.save_as_ndfbin_stream(stream, incremental, compressed);
+  return stream.str();
+}
+
+// only supports appending, like a pipe or a socket
+struct AppendOnlyBuffer : std::streambuf {
+  std::string data;
+  int_type overflow(int_type c) override {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      data.push_back(traits_type::to_char_type(c));
+    }
+    return c;
+  }
+  std::streamsize xsputn(const char *s, std::streamsize n) override {
+    data.append(s, n);
+    return n;
+  }
+};
+
+TEST_CASE("ndfbin roundtrip", "[ndfbin]") {
+  fs::path directory = fs::temp_directory_path() / "testfiles" / "ndfbin";
+  fs::create_directories(directory);
+
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, 100);
+  std::string original = save_to_string(ndf);
+  {
+    std::ofstream file(directory / "roundtrip.ndfbin", std::ios::binary);
+    file.write(original.data(), original.size());
+  }
+
+  SECTION("memory mapped file") {
+    NDF ndf_from_file;
+    ndf_from_file.load_from_ndfbin(directory / "roundtrip.ndfbin");
+    REQUIRE(ndf_from_file.object_map.size() == ndf.object_map.size());
+    REQUIRE(save_to_string(ndf_from_file) == original);
+  }
+
+  SECTION("stream") {
+    NDF ndf_from_stream;
+    std::stringstream stream(original);
+    ndf_from_stream.load_from_ndfbin_stream(stream);
+    REQUIRE(ndf_from_stream.object_map.size() == ndf.object_map.size());
+    REQUIRE(save_to_string(ndf_from_stream) == original);
+  }
+
+  SECTION("lazy") {
+    NDF ndf_lazy;
+    ndf_lazy.load_from_ndfbin(directory / "roundtrip.ndfbin", true);
+    REQUIRE(ndf_lazy.object_map.size() == ndf.object_map.size());
+    // loaded objects are named after their index once they are accessed
+    auto name = ndf_lazy.get_object_name(0);
+    REQUIRE(name == "Object_0");
+    REQUIRE(ndf_lazy.object_map.begin()->second.name.empty());
+    REQUIRE_FALSE(ndf_lazy.object_map.begin()->second.properties_loaded);
+    REQUIRE_THROWS_AS(ndf_lazy.object_map.begin()->second.clone(),
+                      std::runtime_error);
+    REQUIRE_THROWS_AS(ndf_lazy.object_map.begin()->second.get_copy(),
+                      std::runtime_error);
+    auto &object = ndf_lazy.get_object(name);
+    REQUIRE(object.name == name);
+    REQUIRE(object.properties_loaded);
+    REQUIRE_THROWS_AS(ndf_lazy.get_object("Object_00"), std::out_of_range);
+    REQUIRE_THROWS_AS(ndf_lazy.get_object(std::format(
+                          "Object_{}", ndf_lazy.object_map.size())),
+                      std::out_of_range);
+    // their names can't be taken by new objects
+    NDFObject duplicate = ndf_generator::gen_random_object(0);
+    duplicate.name = "Object_1";
+    ndf_lazy.add_object(std::move(duplicate));
+    REQUIRE(ndf_lazy.object_map.size() == ndf.object_map.size());
+    REQUIRE(object.properties().size() ==
+            ndf.object_map.begin()->second.properties().size());
+    REQUIRE(save_to_string(ndf_lazy) == original);
+  }
+
+  SECTION("homogeneous lists are packed") {
+    NDF ndf_packed;
+    ndf_packed.load_from_ndfbin(directory / "roundtrip.ndfbin");
+    // loaded objects are named after their index
+    size_t index = 0;
+    for (auto &[name, object] : ndf.object_map) {
+      auto &packed_object =
+          ndf_packed.get_object("Object_" + std::to_string(index++));
+      for (size_t i = 0; i < object.properties().size(); i++) {
+        if (!object.properties()[i]->is_list()) {
+          continue;
+        }
+        auto *list =
+            static_cast<const NDFPropertyList *>(object.properties()[i].get());
+        auto *packed_list =
+            static_cast<NDFPropertyList *>(&packed_object.edit_property(i));
+        REQUIRE(packed_list->is_packed());
+        REQUIRE(packed_list->size() == list->values().size());
+        // read only access doesn't unpack
+        REQUIRE_THROWS_AS(std::as_const(*packed_list).values(),
+                          std::logic_error);
+        auto &items = packed_list->values();
+        REQUIRE_FALSE(packed_list->is_packed());
+        for (size_t x = 0; x < list->values().size(); x++) {
+          REQUIRE(items[x]->as_string() == list->values()[x]->as_string());
+        }
+      }
+    }
+    REQUIRE(save_to_string(ndf_packed) == original);
+  }
+
+  SECTION("non-seekable output") {
+    AppendOnlyBuffer buffer;
+    std::ostream stream(&buffer);
+    ndf.save_as_ndfbin_stream(stream);
+    REQUIRE(stream.good());
+    REQUIRE(buffer.data == original);
+  }
+
+  SECTION("loading again replaces the previous file") {
+    NDF other;
+    ndf_generator::add_random_objects(other, 20);
+    std::stringstream other_stream(save_to_string(other));
+
+    NDF ndf_reloaded;
+    ndf_reloaded.load_from_ndfbin(directory / "roundtrip.ndfbin", true);
+    ndf_reloaded.load_from_ndfbin_stream(other_stream);
+    REQUIRE(ndf_reloaded.object_map.size() == other.object_map.size());
+    REQUIRE(save_to_string(ndf_reloaded) == other_stream.str());
+  }
+
+  SECTION("failed saves don't leave a temporary file") {
+    NDF ndf_broken;
+    ndf_broken.load_from_ndfbin(directory / "roundtrip.ndfbin");
+    struct BrokenProperty : NDFPropertyUInt32 {
+      void to_ndfbin(NDF *, NDFBinWriter &) const override {
+        throw std::runtime_error("broken property");
+      }
+    };
+    auto broken = std::make_unique<BrokenProperty>();
+    broken->property_name = "BrokenProperty";
+    ndf_broken.get_object("Object_0").add_property(std::move(broken));
+    REQUIRE_THROWS(ndf_broken.save_as_ndfbin(directory / "broken.ndfbin"));
+    REQUIRE_FALSE(fs::exists(directory / "broken.ndfbin"));
+    REQUIRE_FALSE(fs::exists(directory / "broken.ndfbin.tmp"));
+  }
+
+  SECTION("truncated file throws instead of reading out of bounds") {
+    NDF ndf_truncated;
+    std::stringstream stream(original.substr(0, original.size() / 2));
+    REQUIRE_THROWS(ndf_truncated.load_from_ndfbin_stream(stream));
+  }
+}
+
+TEST_CASE("compressed ndfbin", "[ndfbin]") {
+  fs::path directory = fs::temp_directory_path() / "testfiles" / "ndfbin";
+  fs::create_directories(directory);
+
+  // large enough to be deflated in several chunks
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, 2000);
+  std::string original = save_to_string(ndf);
+  std::string compressed = save_to_string(ndf, false, true);
+  REQUIRE(original.size() > 4 * 128 * 1024);
+  REQUIRE(compressed.size() < original.size());
+  // the header is kept, only the compressed flag differs
+  uint32_t flag;
+  std::memcpy(&flag, compressed.data() + 12, sizeof(flag));
+  REQUIRE(flag == 128);
+  REQUIRE(compressed.substr(16, 24) == original.substr(16, 24));
+
+  SECTION("stream") {
+    NDF ndf_from_stream;
+    std::stringstream stream(compressed);
+    ndf_from_stream.load_from_ndfbin_stream(stream);
+    REQUIRE(save_to_string(ndf_from_stream) == original);
+    REQUIRE(save_to_string(ndf_from_stream, true, true) == compressed);
+  }
+
+  SECTION("memory mapped file") {
+    {
+      std::ofstream file(directory / "compressed.ndfbin", std::ios::binary);
+      file.write(compressed.data(), compressed.size());
+    }
+    NDF ndf_from_file;
+    ndf_from_file.load_from_ndfbin(directory / "compressed.ndfbin", true);
+    REQUIRE(save_to_string(ndf_from_file, true) == original);
+  }
+
+  SECTION("truncated file throws") {
+    NDF ndf_truncated;
+    std::stringstream stream(compressed.substr(0, compressed.size() / 2));
+    REQUIRE_THROWS(ndf_truncated.load_from_ndfbin_stream(stream));
+  }
+}
+
+// counts what the visitor sees, to compare against the loaded NDF
+struct CountingVisitor : NDFBinVisitor {
+  size_t objects = 0;
+  size_t properties = 0;
+  size_t list_items = 0;
+  size_t depth = 0;
+  std::vector<std::string> strings;
+
+  bool begin_object(uint32_t, std::string_view) override {
+    objects++;
+    return true;
+  }
+  void property(std::string_view name, const NDFBinValue &value) override {
+    if (depth == 0) {
+      properties++;
+    } else if (name == "ListItem") {
+      list_items++;
+    }
+    if (depth == 0 && value.type == NDFPropertyType::String) {
+      strings.emplace_back(value.string);
+    }
+  }
+  void begin_list(std::string_view, uint32_t) override {
+    if (depth == 0) {
+      properties++;
+    }
+    depth++;
+  }
+  void end_list(std::string_view) override { depth--; }
+  void begin_map(std::string_view, uint32_t) override {
+    if (depth == 0) {
+      properties++;
+    }
+    depth++;
+  }
+  void end_map(std::string_view) override { depth--; }
+  void begin_pair(std::string_view) override {
+    if (depth == 0) {
+      properties++;
+    }
+    depth++;
+  }
+  void end_pair(std::string_view) override { depth--; }
+};
+
+TEST_CASE("ndfbin visitor", "[ndfbin]") {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, 100);
+  std::stringstream stream(save_to_string(ndf));
+
+  CountingVisitor visitor;
+  NDF::visit_ndfbin_stream(stream, visitor);
+
+  size_t properties = 0;
+  size_t list_items = 0;
+  std::vector<std::string> strings;
+  for (auto &[name, object] : ndf.object_map) {
+    for (auto &property : object.properties()) {
+      properties++;
+      if (property->is_list()) {
+        list_items +=
+            static_cast<const NDFPropertyList *>(property.get())->size();
+      }
+      if (property->property_type == NDFPropertyType::String) {
+        strings.push_back(property->as_string());
+      }
+    }
+  }
+  REQUIRE(visitor.objects == ndf.object_map.size());
+  REQUIRE(visitor.properties == properties);
+  REQUIRE(visitor.list_items == list_items);
+  REQUIRE(visitor.strings == strings);
+  REQUIRE(visitor.depth == 0);
+}
+
+TEST_CASE("ndfbin probe", "[ndfbin]") {
+  fs::path directory = fs::temp_directory_path() / "testfiles" / "ndfbin_probe";
+  fs::remove_all(directory);
+  fs::create_directories(directory / "sub");
+
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, 10);
+  ndf.save_as_ndfbin(directory / "a.ndfbin");
+  NDF ndf2;
+  ndf_generator::add_random_objects(ndf2, 20);
+  ndf2.save_as_ndfbin(directory / "sub" / "b.ndfbin");
+  ndf2.save_as_ndfbin(directory / "c.ndfbin", false, true);
+  {
+    std::ofstream file(directory / "broken.ndfbin", std::ios::binary);
+    file << "not a ndfbin";
+  }
+
+  NDFBinProbeOptions options;
+  options.classes = true;
+  options.properties = true;
+  auto summaries = NDF::probe_ndfbin_directory(directory, options);
+  REQUIRE(summaries.size() == 4);
+
+  REQUIRE(summaries[0].path == directory / "a.ndfbin");
+  REQUIRE(summaries[0].error.empty());
+  REQUIRE(summaries[0].object_count == 10);
+  REQUIRE(summaries[0].sections.size() == 9);
+  REQUIRE(summaries[0].sections[0].name == "OBJE");
+  REQUIRE(summaries[0].class_names == std::vector<std::string>{"TTestClass"});
+  REQUIRE_FALSE(summaries[0].property_names.empty());
+
+  REQUIRE(summaries[1].path == directory / "broken.ndfbin");
+  REQUIRE_FALSE(summaries[1].error.empty());
+
+  REQUIRE(summaries[2].path == directory / "c.ndfbin");
+  REQUIRE(summaries[2].error.empty());
+  REQUIRE(summaries[2].compressed);
+
+  REQUIRE(summaries[3].path == directory / "sub" / "b.ndfbin");
+  REQUIRE_FALSE(summaries[3].compressed);
+  REQUIRE(summaries[3].object_count == 20);
+  // compressed files are summarised like the uncompressed ones
+  REQUIRE(summaries[2].size == summaries[3].size);
+  REQUIRE(summaries[2].object_count == 20);
+  REQUIRE(summaries[2].class_names == summaries[3].class_names);
+  REQUIRE(summaries[2].property_names == summaries[3].property_names);
+  REQUIRE(summaries[2].sections.size() == 9);
+}
+
+TEST_CASE("ndfbin hash properties", "[ndfbin]") {
+  NDF ndf;
+  NDFObject object = ndf_generator::gen_random_object(1);
+  auto guid = std::make_unique<NDFPropertyGUID>();
+  guid->property_name = "Guid";
+  guid->guid = hex_to_bytes<16>("00112233445566778899AABBCCDDEEFF");
+  object.add_property(std::move(guid));
+  auto hash = std::make_unique<NDFPropertyHash>();
+  hash->property_name = "Hash";
+  hash->hash = hex_to_bytes<16>("0123456789abcdef0123456789ABCDEF");
+  object.add_property(std::move(hash));
+  auto localisation_hash = std::make_unique<NDFPropertyLocalisationHash>();
+  localisation_hash->property_name = "LocalisationHash";
+  localisation_hash->hash = hex_to_bytes<8>("FEDCBA9876543210");
+  object.add_property(std::move(localisation_hash));
+  ndf.add_object(std::move(object));
+
+  NDF loaded;
+  std::stringstream stream(save_to_string(ndf));
+  loaded.load_from_ndfbin_stream(stream);
+  auto &loaded_object = loaded.get_object("Object_0");
+  REQUIRE(loaded_object.get_property("Guid").as_string() ==
+          "00112233445566778899AABBCCDDEEFF");
+  // all 16 bytes of a hash have to survive the roundtrip
+  REQUIRE(loaded_object.get_property("Hash").as_string() ==
+          "0123456789ABCDEF0123456789ABCDEF");
+  REQUIRE(loaded_object.get_property("LocalisationHash").as_string() ==
+          "FEDCBA9876543210");
+
+  REQUIRE_THROWS(hex_to_bytes<8>("0123"));
+  REQUIRE_THROWS(hex_to_bytes<2>("0G12"));
+}
+
+TEST_CASE("ndfbin table indices are bounds checked", "[ndfbin]") {
+  // the property is the only one of the only object, its table index is
+  // written at offset after the header
+  auto load_corrupted = [](std::unique_ptr<NDFProperty> property,
+                           size_t offset, uint32_t index = 1000) {
+    NDF ndf;
+    NDFObject object = ndf_generator::gen_random_object(1);
+    object.add_property(std::move(property));
+    ndf.add_object(std::move(object));
+    std::string data = save_to_string(ndf);
+    std::memcpy(data.data() + offset, &index, sizeof(index));
+    NDF loaded;
+    std::stringstream stream(data);
+    loaded.load_from_ndfbin_stream(stream);
+  };
+
+  // class, property and type index
+  REQUIRE_THROWS_AS(load_corrupted(ndf_generator::gen_random_string(0), 52),
+                    std::out_of_range);
+  auto path = std::make_unique<NDFPropertyPathReference>();
+  path->property_name = "Path";
+  path->path = "GameData:/test";
+  REQUIRE_THROWS_AS(load_corrupted(std::move(path), 52), std::out_of_range);
+  // and the reference type
+  REQUIRE_THROWS_AS(
+      load_corrupted(ndf_generator::gen_import_reference(0, "$/test/a"), 56),
+      std::out_of_range);
+  // odd and oversized wide string lengths
+  auto wide_string = [] {
+    auto ret = std::make_unique<NDFPropertyWideString>();
+    ret->property_name = "WideString";
+    ret->value = "test";
+    return ret;
+  };
+  REQUIRE_THROWS_AS(load_corrupted(wide_string(), 52, 7), std::runtime_error);
+  REQUIRE_THROWS_AS(load_corrupted(wide_string(), 52, 0x40000000),
+                    std::runtime_error);
+}
+
+TEST_CASE("path trie shares prefixes", "[ndfbin]") {
+  std::vector<std::string> tran_table;
+  auto get_tran = [&](std::string_view str) -> uint32_t {
+    auto it = std::find(tran_table.begin(), tran_table.end(), str);
+    if (it != tran_table.end()) {
+      return it - tran_table.begin();
+    }
+    tran_table.emplace_back(str);
+    return tran_table.size() - 1;
+  };
+
+  NDFPathTrie paths;
+  uint32_t a = paths.get_or_add_path("$/GFX/Unit/A", get_tran);
+  uint32_t b = paths.get_or_add_path("$/GFX/Unit/B", get_tran);
+  uint32_t c = paths.get_or_add_path("$/GFX/Weapon", get_tran);
+  REQUIRE(paths.get_or_add_path("$/GFX/Unit/A", get_tran) == a);
+  // root + $, GFX, Unit, A, B, Weapon
+  REQUIRE(paths.size() == 7);
+  REQUIRE(paths.get_node(a).parent == paths.get_node(b).parent);
+  REQUIRE(paths.get_path(a, tran_table) == "$/GFX/Unit/A");
+  REQUIRE(paths.get_path(c, tran_table) == "$/GFX/Weapon");
+
+  paths.get_node(a).index = 0;
+  paths.get_node(c).index = 1;
+  NDFBinWriter writer;
+  paths.write_ndfbin(writer);
+
+  NDFPathTrie loaded;
+  NDFBinReader reader(writer.data());
+  loaded.read_ndfbin(reader);
+  std::vector<std::string> names;
+  loaded.for_each_indexed([&](uint32_t node, uint32_t) {
+    names.push_back(loaded.get_path(node, tran_table));
+  });
+  REQUIRE(names == std::vector<std::string>{"$/GFX/Unit/A", "$/GFX/Weapon"});
+
+  // a corrupt child count throws before allocating the offsets
+  std::string corrupted(writer.data().begin(), writer.data().end());
+  uint32_t count = 0x40000000;
+  std::memcpy(corrupted.data() + 2 * sizeof(uint32_t), &count, sizeof(count));
+  NDFPathTrie corrupted_paths;
+  NDFBinReader corrupted_reader(corrupted);
+  REQUIRE_THROWS_AS(corrupted_paths.read_ndfbin(corrupted_reader),
+                    std::runtime_error);
+}
+
+TEST_CASE("ndfbin incremental save", "[ndfbin]") {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, 100);
+  ndf_generator::add_object_reference(ndf.get_object("test_object_1"),
+                                      "test_object_2");
+  std::string original = save_to_string(ndf);
+
+  NDF loaded;
+  std::stringstream stream(original);
+  loaded.load_from_ndfbin_stream(stream, true);
+
+  SECTION("unchanged objects are copied") {
+    REQUIRE(save_to_string(loaded, true) == original);
+    // nothing had to be decoded
+    REQUIRE_FALSE(loaded.object_map.begin()->second.properties_loaded);
+  }
+
+  SECTION("modified objects are encoded again") {
+    auto &object = loaded.get_object("Object_5");
+    object.modifications++;
+    auto string = std::make_unique<NDFPropertyString>();
+    string->property_name = "NewProperty";
+    string->value = "new string";
+    object.add_property(std::move(string));
+    loaded.add_object(ndf_generator::gen_random_object(1000));
+
+    NDF reloaded;
+    std::stringstream saved(save_to_string(loaded, true));
+    reloaded.load_from_ndfbin_stream(saved);
+    REQUIRE(reloaded.object_map.size() == loaded.object_map.size());
+    size_t index = 0;
+    for (auto &object : loaded.objects()) {
+      auto &reloaded_object =
+          reloaded.get_object("Object_" + std::to_string(index++));
+      REQUIRE(reloaded_object.class_name == object.class_name);
+      REQUIRE(reloaded_object.properties().size() ==
+              object.properties().size());
+      for (size_t i = 0; i < object.properties().size(); i++) {
+        REQUIRE(reloaded_object.properties()[i]->property_name ==
+                object.properties()[i]->property_name);
+        REQUIRE(reloaded_object.properties()[i]->as_string() ==
+                object.properties()[i]->as_string());
+      }
+    }
+    REQUIRE(reloaded.get_object("Object_5").get_property("NewProperty")
+                .as_string() == "new string");
+  }
+
+  SECTION("objects with other properties are encoded again") {
+    // the properties can't be changed without counting a modification
+    auto &object = loaded.get_object("Object_5");
+    STATIC_REQUIRE(std::is_same_v<decltype(object.properties()),
+                                  const std::vector<NDFPropertyRef> &>);
+    object.remove_property(object.properties().size() - 1);
+    REQUIRE(object.modifications == 1);
+    std::string saved = save_to_string(loaded, true);
+    REQUIRE(saved == save_to_string(loaded));
+    REQUIRE(saved != original);
+  }
+
+  SECTION("objects referencing an object with a new class are encoded again") {
+    // references store the class index of the referenced object
+    auto &referenced = loaded.get_object("Object_1");
+    referenced.class_name = "TOtherClass";
+    referenced.modifications++;
+    std::string saved = save_to_string(loaded, true);
+    REQUIRE(saved == save_to_string(loaded));
+    REQUIRE(saved != original);
+  }
+}
+
+TEST_CASE("ndf schema", "[ndfbin]") {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, 10);
+  auto &object = ndf.get_object("test_object_1");
+  const NDFSchema &schema = ndf.get_schema();
+  uint32_t class_idx = schema.find_class("TTestClass");
+  REQUIRE(class_idx == 0);
+  for (auto &property : object.properties()) {
+    REQUIRE(schema.find_property(class_idx, property->property_name) !=
+            NDFSymbolTable::no_index);
+  }
+  std::string saved = save_to_string(ndf);
+  REQUIRE(save_to_string(ndf) == saved);
+
+  auto new_property = [] {
+    auto string = std::make_unique<NDFPropertyString>();
+    string->property_name = "NewProperty";
+    string->value = "new string";
+    return string;
+  };
+  auto remove_new_property = [](NDFObject &object) {
+    object.remove_property(object.find_property("NewProperty"));
+  };
+
+  // new properties are picked up by the next save
+  auto &other = ndf.get_object("test_object_2");
+  object.add_property(new_property());
+  other.add_property(new_property());
+  REQUIRE(ndf.get_schema().find_property(class_idx, "NewProperty") ==
+          schema.properties.size() - 1);
+  std::string saved_new = save_to_string(ndf);
+
+  // and dropped with the last object using them
+  remove_new_property(object);
+  REQUIRE(ndf.get_schema().find_property(class_idx, "NewProperty") !=
+          NDFSymbolTable::no_index);
+  remove_new_property(other);
+  REQUIRE(ndf.get_schema().find_property(class_idx, "NewProperty") ==
+          NDFSymbolTable::no_index);
+  REQUIRE(save_to_string(ndf) == saved);
+
+  // replacing all properties is noticed as well
+  std::vector<NDFPropertyRef> replaced = object.properties();
+  replaced.push_back(new_property());
+  object.assign_properties(replaced.begin(), replaced.end());
+  REQUIRE(ndf.get_schema().find_property(class_idx, "NewProperty") ==
+          schema.properties.size() - 1);
+  replaced.pop_back();
+  object.assign_properties(replaced.begin(), replaced.end());
+  REQUIRE(ndf.get_schema().find_property(class_idx, "NewProperty") ==
+          NDFSymbolTable::no_index);
+  REQUIRE(save_to_string(ndf) == saved);
+  ndf.rebuild_schema();
+  REQUIRE(save_to_string(ndf) == saved);
+
+  // loaded files start out with their own tables
+  NDF loaded;
+  std::stringstream stream(saved);
+  loaded.load_from_ndfbin_stream(stream, true);
+  REQUIRE(loaded.get_schema().properties == schema.properties);
+  REQUIRE_FALSE(loaded.object_map.begin()->second.properties_loaded);
+
+  // and know which objects use a property without decoding them
+  std::stringstream new_stream(saved_new);
+  loaded.load_from_ndfbin_stream(new_stream, true);
+  remove_new_property(loaded.get_object("Object_0"));
+  REQUIRE(loaded.get_schema().find_property(class_idx, "NewProperty") !=
+          NDFSymbolTable::no_index);
+  REQUIRE_FALSE(loaded.object_map.get(2).properties_loaded);
+  remove_new_property(loaded.get_object("Object_1"));
+  // the PROP table of the file keeps its indices without users
+  uint32_t new_idx =
+      loaded.get_schema().find_property(class_idx, "NewProperty");
+  REQUIRE(new_idx != NDFSymbolTable::no_index);
+  REQUIRE(loaded.get_schema().properties.size() ==
+          schema.properties.size() + 1);
+  std::string saved_removed = save_to_string(loaded, true);
+  REQUIRE(saved_removed == save_to_string(loaded));
+  loaded.get_object("Object_2").add_property(new_property());
+  REQUIRE(loaded.get_schema().find_property(class_idx, "NewProperty") ==
+          new_idx);
+  remove_new_property(loaded.get_object("Object_2"));
+  // until the schema is rebuilt
+  loaded.rebuild_schema();
+  REQUIRE(loaded.get_schema().find_property(class_idx, "NewProperty") ==
+          NDFSymbolTable::no_index);
+  REQUIRE(save_to_string(loaded, true) == saved);
+}
+
+TEST_CASE("objects share property layouts", "[ndfbin]") {
+  NDF ndf;
+  for (int id = 1; id <= 2; id++) {
+    NDFObject object = ndf_generator::gen_random_object(id);
+    for (int i = 0; i < 5; i++) {
+      object.add_property(ndf_generator::gen_random_uint32(i));
+    }
+    ndf.add_object(std::move(object));
+  }
+  NDF loaded;
+  std::stringstream stream(save_to_string(ndf));
+  loaded.load_from_ndfbin_stream(stream);
+
+  auto &first = loaded.get_object("Object_0");
+  auto &second = loaded.get_object("Object_1");
+  const auto &name = first.properties()[3]->property_name;
+  REQUIRE(&first.get_property(name) == first.properties()[3].get());
+  REQUIRE(&first.get_property(name.str()) == first.properties()[3].get());
+  REQUIRE(second.find_property(name) == 3);
+  REQUIRE(first.layout == second.layout);
+  // names nothing interned can't be looked up
+  REQUIRE(first.find_property("NeverUsedPropertyName") ==
+          NDFPropertyLayout::no_slot);
+  REQUIRE_THROWS_AS(first.get_property("NeverUsedPropertyName"),
+                    std::out_of_range);
+
+  // value edits keep the layout
+  auto layout = first.layout;
+  first.edit_property(name);
+  REQUIRE(first.find_property(name) == 3);
+  REQUIRE(first.layout == layout);
+
+  // lookups pick up changed properties
+  std::weak_ptr<const NDFPropertyLayout> copy_layout;
+  {
+    NDFObject copy = first.get_copy();
+    REQUIRE(copy.layout == first.layout);
+    copy.remove_property(0);
+    REQUIRE(copy.find_property(name) == 2);
+    REQUIRE(copy.layout != first.layout);
+    REQUIRE(first.find_property(name) == 3);
+    copy_layout = copy.layout;
+  }
+  // layouts are freed with the last object using them
+  REQUIRE(copy_layout.expired());
+}
+
+TEST_CASE("cloned objects share properties until edited", "[ndfbin]") {
+  NDF ndf;
+  NDFObject base = ndf_generator::gen_random_object(0);
+  for (int i = 0; i < 5; i++) {
+    base.add_property(ndf_generator::gen_random_uint32(i));
+  }
+  base.add_property(ndf_generator::gen_random_list(5));
+  {
+    NDFObject clone = base.clone();
+    REQUIRE(clone.properties() == base.properties());
+    REQUIRE(base.properties()[0].is_shared());
+  }
+  REQUIRE_FALSE(base.properties()[0].is_shared());
+  ndf.add_object(base.clone());
+
+  for (uint32_t i = 1; i <= 3; i++) {
+    NDFObject variant = ndf.get_object("test_object_0").clone();
+    variant.name = std::format("test_object_{}", i);
+    auto &value = static_cast<NDFPropertyUInt32 &>(
+        variant.edit_property("TestUInt32_1"));
+    value.value = i;
+    REQUIRE(variant.modifications == 1);
+    REQUIRE(variant.properties()[0] == base.properties()[0]);
+    REQUIRE_FALSE(variant.properties()[1] == base.properties()[1]);
+    ndf.add_object(std::move(variant));
+  }
+  REQUIRE(base.properties()[5].is_shared());
+  // shared properties can only be changed through edit_property
+  static_assert(
+      std::is_same_v<decltype(*base.properties()[0]), const NDFProperty &>);
+  static_assert(std::is_same_v<decltype(base.get_property("TestUInt32_0")),
+                               const NDFProperty &>);
+
+  NDF loaded;
+  std::stringstream stream(save_to_string(ndf));
+  loaded.load_from_ndfbin_stream(stream);
+  auto &original = loaded.get_object("Object_0");
+  for (uint32_t i = 1; i <= 3; i++) {
+    auto &variant = loaded.get_object(std::format("Object_{}", i));
+    REQUIRE(variant.get<uint32_t>("TestUInt32_1") == i);
+    for (uint32_t slot : {0, 2, 3, 4, 5}) {
+      REQUIRE(variant.properties()[slot]->as_string() ==
+              original.properties()[slot]->as_string());
+    }
+  }
+}
+
+TEST_CASE("identical container properties are deduplicated", "[ndfbin]") {
+  NDF ndf;
+  auto list = ndf_generator::gen_random_list(0);
+  auto map = ndf_generator::gen_random_map(1);
+  for (int i = 0; i < 5; i++) {
+    NDFObject object = ndf_generator::gen_random_object(i);
+    object.add_property(list->get_copy());
+    object.add_property(map->get_copy());
+    if (i == 3) {
+      static_cast<NDFPropertyList &>(object.edit_property(0))
+          .values()
+          .push_back(ndf_generator::gen_random_uint32(-1));
+    }
+    // property indices differ between classes
+    if (i == 4) {
+      object.class_name = "TOtherClass";
+    }
+    ndf.add_object(std::move(object));
+  }
+  std::string saved = save_to_string(ndf);
+
+  auto &stats = ndf.deduplicate_properties();
+  REQUIRE(stats.at("TTestClass").properties == 5);
+  REQUIRE(stats.at("TTestClass").bytes > 0);
+  REQUIRE_FALSE(stats.contains("TOtherClass"));
+  auto &first = ndf.get_object("test_object_0");
+  for (int i = 1; i < 4; i++) {
+    auto &object = ndf.get_object(std::format("test_object_{}", i));
+    REQUIRE((object.properties()[0] == first.properties()[0]) == (i != 3));
+    REQUIRE(object.properties()[1] == first.properties()[1]);
+  }
+  auto &other = ndf.get_object("test_object_4");
+  REQUIRE_FALSE(other.properties()[0] == first.properties()[0]);
+  REQUIRE_FALSE(other.properties()[1] == first.properties()[1]);
+  REQUIRE(save_to_string(ndf) == saved);
+
+  auto &object = ndf.get_object("test_object_1");
+  static_cast<NDFPropertyList &>(object.edit_property(0))
+      .values()
+      .push_back(ndf_generator::gen_random_uint32(-1));
+  REQUIRE_FALSE(object.properties()[0] == first.properties()[0]);
+  REQUIRE(first.properties()[0].is_shared());
+
+  NDF loaded;
+  std::stringstream stream(saved);
+  loaded.load_from_ndfbin_stream(stream, false, true);
+  REQUIRE(loaded.get_dedup_stats().at("TTestClass").properties == 5);
+  REQUIRE(loaded.get_object("Object_1").properties()[1] ==
+          loaded.get_object("Object_0").properties()[1]);
+  REQUIRE(save_to_string(loaded) == saved);
+
+  // the stats belong to the loaded file
+  std::stringstream reload_stream(saved);
+  loaded.load_from_ndfbin_stream(reload_stream);
+  REQUIRE(loaded.get_dedup_stats().empty());
+}
+
+TEST_CASE("shared properties are saved on multiple threads", "[ndfbin]") {
+  // the writer uses at most one thread per 256 objects, all objects share
+  // the properties of a few objects through clones or deduplication
+  std::vector<NDFObject> originals;
+  for (int i = 0; i < 4; i++) {
+    NDFObject object = ndf_generator::gen_random_object(i);
+    ndf_generator::add_random_properties(object, 10);
+    object.add_property(ndf_generator::gen_random_list(10));
+    object.add_property(
+        ndf_generator::gen_import_reference(11, std::format("$/test/{}", i)));
+    originals.push_back(std::move(object));
+  }
+  NDF shared;
+  NDF copied;
+  for (int i = 0; i < 2400; i++) {
+    const auto &original = originals[i % originals.size()];
+    NDFObject clone = original.clone();
+    clone.name = std::format("clone_{}", i);
+    clone.export_path.clear();
+    NDFObject copy = clone.get_copy();
+    shared.add_object(std::move(clone));
+    copied.add_object(std::move(copy));
+  }
+  std::string saved = save_to_string(copied);
+  REQUIRE(save_to_string(shared) == saved);
+
+  NDF loaded;
+  std::stringstream stream(saved);
+  loaded.load_from_ndfbin_stream(stream, false, true);
+  REQUIRE(loaded.get_dedup_stats().at("TTestClass").properties > 0);
+  REQUIRE(save_to_string(loaded) == saved);
+}
+
+TEST_CASE("symbol table keeps insertion order", "[ndfbin]") {
+  NDFSymbolTable table;
+  for (int i = 0; i < 1000; i++) {
+    REQUIRE(table.get_or_add("string_" + std::to_string(i)) == i);
+  }
+  REQUIRE(table.get_or_add("string_500") == 500);
+  REQUIRE(table.find("string_999") == 999);
+  REQUIRE(table.find("string_1000") == NDFSymbolTable::no_index);
+  REQUIRE(table.size() == 1000);
+  REQUIRE(table[42] == "string_42");
+}
+
+TEST_CASE("objects don't move when more are added", "[ndfbin]") {
+  NDF ndf;
+  ndf.add_object(ndf_generator::gen_random_object(0));
+  NDFObject *first = &ndf.get_object("test_object_0");
+  for (int i = 1; i < 1000; i++) {
+    ndf.add_object(ndf_generator::gen_random_object(i));
+  }
+  REQUIRE(&ndf.get_object("test_object_0") == first);
+  REQUIRE(ndf.object_map.size() == 1000);
+  REQUIRE(ndf.object_map.index_of("test_object_500") == 500);
+  REQUIRE(ndf.object_map.index_of("test_object_1000") ==
+          NDFSlabMap<NDFObject>::no_index);
+  REQUIRE(ndf.object_map.get(999).name == "test_object_999");
+  // duplicate names are ignored
+  NDFObject duplicate = ndf_generator::gen_random_object(1);
+  duplicate.class_name = "TOtherClass";
+  ndf.add_object(std::move(duplicate));
+  REQUIRE(ndf.object_map.size() == 1000);
+  REQUIRE(ndf.get_object("test_object_1").class_name == "TTestClass");
+  int i = 0;
+  for (auto &object : ndf.objects()) {
+    REQUIRE(object.name == std::format("test_object_{}", i++));
+  }
+}
+
+TEST_CASE("typed property accessors and paths", "[ndfbin]") {
+  NDF ndf;
+  NDFObject first = ndf_generator::gen_random_object(0);
+  NDFObject second = ndf_generator::gen_random_object(1);
+  ndf_generator::add_object_reference(first, second.name);
+  ndf_generator::add_random_map(first);
+  ndf_generator::add_random_list(second);
+  ndf_generator::add_random_string(second);
+
+  auto &map = static_cast<const NDFPropertyMap &>(*first.properties()[1]);
+  uint32_t key = ndf_get<uint32_t>(*map.values()[0].first);
+  int32_t value = ndf_get<int32_t>(*map.values()[0].second);
+  std::vector<uint32_t> items;
+  for (auto &item :
+       static_cast<const NDFPropertyList &>(*second.properties()[0])
+           .values()) {
+    items.push_back(static_cast<NDFPropertyUInt32 &>(*item).value);
+  }
+  std::string str =
+      static_cast<const NDFPropertyString &>(*second.properties()[1]).value;
+  ndf.add_object(std::move(first));
+  ndf.add_object(std::move(second));
+
+  NDF loaded;
+  std::stringstream stream(save_to_string(ndf));
+  loaded.load_from_ndfbin_stream(stream);
+
+  // paths are reused for both files
+  NDFPropertyPath item_path("ObjRef_0/TestList_0[3]");
+  NDFPropertyPath string_path("ObjRef_0/TestString_1");
+  NDFPropertyPath map_path(std::format("TestMap_1[{}]", key));
+  NDFPropertyPath missing_path("ObjRef_0/TestList_0[10]");
+  auto check = [&](NDF &file, NDFObject &object_0, NDFObject &object_1) {
+    REQUIRE(std::ranges::equal(object_1.get_list<uint32_t>("TestList_0"),
+                               items));
+    REQUIRE(object_1.get<std::string_view>("TestString_1") == str);
+    REQUIRE_THROWS_AS(object_1.get<float>("TestString_1"), std::runtime_error);
+    REQUIRE_THROWS_AS(object_1.get<float>("Missing"), std::out_of_range);
+    REQUIRE(item_path.get<uint32_t>(file, object_0) == items[3]);
+    REQUIRE(string_path.get<std::string_view>(file, object_0) == str);
+    REQUIRE(map_path.get<int32_t>(file, object_0) == value);
+    REQUIRE_FALSE(missing_path.resolve(file, object_0));
+    REQUIRE_FALSE(item_path.resolve(file, object_1));
+    REQUIRE(ndf_visit(*object_0.properties()[1], []<typename P>(const P &) {
+      return std::is_same_v<P, NDFPropertyMap>;
+    }));
+  };
+  check(ndf, ndf.get_object("test_object_0"), ndf.get_object("test_object_1"));
+  auto &loaded_first = loaded.get_object("Object_0");
+  check(loaded, loaded_first, loaded.get_object("Object_1"));
+  REQUIRE(loaded_first.get<NDFObjectValue>("ObjRef_0").object_index == 1);
+  // packed lists are checked up front
+  REQUIRE_THROWS_AS(loaded.get_object("Object_1").get_list<float>("TestList_0"),
+                    std::runtime_error);
+
+  // the object a path starts at is decoded too
+  NDF lazy;
+  std::stringstream lazy_stream(save_to_string(ndf));
+  lazy.load_from_ndfbin_stream(lazy_stream, true);
+  auto &lazy_first = lazy.object_map.get(0);
+  REQUIRE_FALSE(lazy_first.properties_loaded);
+  REQUIRE(item_path.get<uint32_t>(lazy, lazy_first) == items[3]);
+  REQUIRE(lazy_first.properties_loaded);
+  auto &lazy_second = lazy.object_map.get(1);
+  REQUIRE_THROWS_AS(lazy_second.get<std::string_view>("TestString_1"),
+                    std::runtime_error);
+
+  // packed references without an object can't be followed
+  auto &unresolved = ndf.get_object("test_object_0");
+  auto references = std::make_unique<NDFPropertyList>();
+  references->property_name = "PackedReferences";
+  references->packed_values.push_back(
+      NDFObjectValue{NDFPropertyObjectReference::no_object});
+  unresolved.add_property(std::move(references));
+  REQUIRE_FALSE(NDFPropertyPath("PackedReferences[0]/TestString_1")
+                    .resolve(ndf, unresolved));
+
+  REQUIRE_THROWS_AS(NDFPropertyPath("TestList_0/[1]"), std::runtime_error);
+  REQUIRE_THROWS_AS(NDFPropertyPath("TestList_0[1"), std::runtime_error);
+  REQUIRE_THROWS_AS(NDFPropertyPath(""), std::runtime_error);
+}
+
+// counts the items of property trees, packed or not
+struct CountingWalker : NDFPropertyWalker<CountingWalker> {
+  size_t items = 0;
+  size_t strings = 0;
+  size_t containers = 0;
+
+  using NDFPropertyWalker::leaf;
+  void leaf(const NDFPropertyString &) {
+    items++;
+    strings++;
+  }
+  void leaf(const NDFPropertyUInt32 &) { items++; }
+  void leaf(const NDFPropertyInt32 &) { items++; }
+  void value(const NDFValue &value) {
+    items++;
+    strings += std::holds_alternative<NDFStringValue>(value);
+  }
+  bool begin_list(const NDFPropertyList &) {
+    containers++;
+    return true;
+  }
+  bool begin_map(const NDFPropertyMap &) {
+    containers++;
+    return true;
+  }
+};
+
+TEST_CASE("property walker sees packed and unpacked trees alike", "[ndfbin]") {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, 100);
+  NDF loaded;
+  std::stringstream stream(save_to_string(ndf));
+  loaded.load_from_ndfbin_stream(stream);
+
+  CountingWalker walker;
+  size_t containers = 0;
+  for (auto &object : ndf.objects()) {
+    for (auto &property : object.properties()) {
+      walker.walk(*property);
+      containers += property->is_list() || property->is_map();
+    }
+  }
+  REQUIRE(walker.containers == containers);
+  REQUIRE(walker.items > containers);
+
+  CountingWalker loaded_walker;
+  for (auto &object : loaded.objects()) {
+    for (auto &property : object.properties()) {
+      loaded_walker.walk(*property);
+    }
+  }
+  REQUIRE(loaded_walker.items == walker.items);
+  REQUIRE(loaded_walker.strings == walker.strings);
+  REQUIRE(loaded_walker.containers == walker.containers);
+}
+
+TEST_CASE("ndfbin object references store the object index", "[ndfbin]") {
+  NDF ndf;
+  NDFObject first = ndf_generator::gen_random_object(1);
+  NDFObject second = ndf_generator::gen_random_object(2);
+  second.class_name = "TOtherClass";
+  ndf_generator::add_object_reference(first, second.name);
+  ndf_generator::add_object_reference(second, first.name);
+  ndf.add_object(std::move(first));
+  ndf.add_object(std::move(second));
+  std::string original = save_to_string(ndf);
+
+  NDF loaded;
+  std::stringstream stream(original);
+  loaded.load_from_ndfbin_stream(stream);
+  auto *reference = static_cast<const NDFPropertyObjectReference *>(
+      loaded.get_object("Object_0").properties()[0].get());
+  REQUIRE(reference->object_index == 1);
+  REQUIRE(reference->object_name.empty());
+  // the name is only materialised on demand
+  REQUIRE(reference->as_string() == "Object_1");
+  REQUIRE(save_to_string(loaded) == original);
+}
+
+TEST_CASE("ndfbin containers keep fixed size items as values", "[ndfbin]") {
+  NDF ndf;
+  NDFObject first = ndf_generator::gen_random_object(1);
+  NDFObject second = ndf_generator::gen_random_object(2);
+
+  auto references = std::make_unique<NDFPropertyList>();
+  references->property_name = "References";
+  for (int i = 0; i < 3; i++) {
+    references->values().push_back(ndf_generator::gen_random_string(-1));
+    references->values().push_back(
+        ndf_generator::gen_object_reference(-1, second.name));
+    references->values().push_back(
+        ndf_generator::gen_import_reference(-1, "$/Import/Path"));
+  }
+  first.add_property(std::move(references));
+
+  auto pair = std::make_unique<NDFPropertyPair>();
+  pair->property_name = "Pair";
+  pair->first = ndf_generator::gen_random_string(-1);
+  pair->second = ndf_generator::gen_random_uint16(-1);
+  first.add_property(std::move(pair));
+
+  // a map whose values are lists can't be packed
+  auto map = std::make_unique<NDFPropertyMap>();
+  map->property_name = "Map";
+  map->values().push_back({ndf_generator::gen_random_uint32(-1),
+                         ndf_generator::gen_random_list(-1)});
+  first.add_property(std::move(map));
+  first.add_property(ndf_generator::gen_random_map(3));
+
+  std::vector<std::string> expected;
+  for (auto &property : first.properties()) {
+    expected.push_back(property->as_string());
+  }
+  ndf.add_object(std::move(first));
+  ndf.add_object(std::move(second));
+  std::string original = save_to_string(ndf);
+
+  NDF loaded;
+  std::stringstream stream(original);
+  loaded.load_from_ndfbin_stream(stream);
+  auto &object = loaded.get_object("Object_0");
+  auto *loaded_references =
+      static_cast<NDFPropertyList *>(&object.edit_property(0));
+  auto *loaded_pair = static_cast<NDFPropertyPair *>(&object.edit_property(1));
+  auto *loaded_map = static_cast<NDFPropertyMap *>(&object.edit_property(2));
+  auto *loaded_packed_map =
+      static_cast<NDFPropertyMap *>(&object.edit_property(3));
+  REQUIRE(loaded_references->is_packed());
+  REQUIRE(loaded_references->size() == 9);
+  REQUIRE(std::get<NDFObjectValue>(loaded_references->packed_values[1])
+              .object_index == 1);
+  REQUIRE(std::get<NDFImportValue>(loaded_references->packed_values[2])
+              .import_name == "$/Import/Path");
+  REQUIRE(loaded_pair->is_packed());
+  REQUIRE_FALSE(loaded_map->is_packed());
+  REQUIRE(loaded_map->size() == 1);
+  REQUIRE(loaded_packed_map->is_packed());
+  REQUIRE(loaded_packed_map->size() == 10);
+  for (size_t i = 0; i < expected.size(); i++) {
+    REQUIRE(object.properties()[i]->as_string() == expected[i]);
+  }
+
+  // copies own their strings, other values stay packed. unpacking creates
+  // the same properties
+  NDFObject copy = object.get_copy();
+  REQUIRE_FALSE(static_cast<const NDFPropertyList *>(copy.properties()[0].get())
+                    ->is_packed());
+  REQUIRE(static_cast<const NDFPropertyMap *>(copy.properties()[3].get())
+              ->is_packed());
+  REQUIRE(save_to_string(loaded) == original);
+  // the item properties of packed containers can't be read as empty
+  REQUIRE_THROWS_AS(std::as_const(*loaded_references).values(),
+                    std::logic_error);
+  REQUIRE_THROWS_AS(std::as_const(*loaded_packed_map).values(),
+                    std::logic_error);
+  // changing them unpacks first, so added items are counted
+  loaded_references->values().push_back(ndf_generator::gen_random_string(-1));
+  REQUIRE_FALSE(loaded_references->is_packed());
+  REQUIRE(loaded_references->size() == 10);
+  loaded_references->values().pop_back();
+  loaded_pair->unpack();
+  REQUIRE(loaded_references->values()[1]->as_string() == "Object_1");
+  REQUIRE(loaded_pair->first->property_name == "First");
+  REQUIRE(loaded_packed_map->values().size() == 10);
+  REQUIRE_FALSE(loaded_packed_map->is_packed());
+  REQUIRE(save_to_string(loaded) == original);
+}
+
+TEST_CASE("ndfbin properties are allocated from arenas", "[ndfbin]") {
+  NDF ndf;
+  NDFObject object;
+  object.name = "Object_0";
+  object.class_name = "TTestClass";
+  object.add_property(ndf_generator::gen_random_uint32(0));
+  object.add_property(ndf_generator::gen_random_string(1));
+  auto list = std::make_unique<NDFPropertyList>();
+  list->property_name = "List";
+  for (int i = 0; i < 10; i++) {
+    list->values().push_back(ndf_generator::gen_random_uint32(-1));
+  }
+  object.add_property(std::move(list));
+  ndf.add_object(std::move(object));
+  std::string original = save_to_string(ndf);
+  REQUIRE(ndf.get_arena_stats().empty());
+
+  NDF copied;
+  {
+    NDF loaded;
+    std::stringstream stream(original);
+    loaded.load_from_ndfbin_stream(stream);
+    auto stats = loaded.get_arena_stats();
+    REQUIRE(stats.size() == 1);
+    REQUIRE(stats[0].allocations > 0);
+    REQUIRE(stats[0].allocated_bytes > 0);
+    REQUIRE(stats[0].reserved_bytes >= stats[0].allocated_bytes);
+
+    // copies are allocated from the heap and outlive the arenas
+    copied.add_object(loaded.get_object("Object_0").get_copy());
+    REQUIRE(static_cast<const NDFPropertyList *>(
+                copied.get_object("Object_0").properties()[2].get())
+                ->is_packed());
+    loaded.clear();
+    REQUIRE(loaded.get_arena_stats().empty());
+  }
+  REQUIRE(save_to_string(copied) == original);
+  REQUIRE(copied.get_arena_stats().empty());
+
+  // moved objects get their properties copied into the arena of the NDF
+  // they are added to
+  NDF moved;
+  {
+    NDF loaded;
+    std::stringstream stream(original);
+    loaded.load_from_ndfbin_stream(stream);
+    moved.add_object(std::move(loaded.get_object("Object_0")));
+    loaded.clear();
+
+    // undecoded objects can only be decoded by their own NDF
+    std::stringstream lazy_stream(original);
+    loaded.load_from_ndfbin_stream(lazy_stream, true);
+    NDF other;
+    REQUIRE_THROWS_AS(other.add_object(std::move(loaded.object_map.get(0))),
+                      std::runtime_error);
+  }
+  REQUIRE(moved.get_arena_stats().size() == 1);
+  REQUIRE(save_to_string(moved) == original);
+}
+
+TEST_CASE("copies of packed containers own their strings", "[ndfbin]") {
+  NDF ndf;
+  NDFObject object;
+  object.name = "Object_0";
+  object.class_name = "TTestClass";
+  auto strings = std::make_unique<NDFPropertyList>();
+  strings->property_name = "Strings";
+  auto imports = std::make_unique<NDFPropertyList>();
+  imports->property_name = "Imports";
+  auto paths = std::make_unique<NDFPropertyList>();
+  paths->property_name = "Paths";
+  auto map = std::make_unique<NDFPropertyMap>();
+  map->property_name = "Map";
+  for (int i = 0; i < 10; i++) {
+    strings->values().push_back(ndf_generator::gen_random_string(-1));
+    imports->values().push_back(ndf_generator::gen_import_reference(
+        -1, std::format("$/test/import{}", i)));
+    auto path = std::make_unique<NDFPropertyPathReference>();
+    path->path = std::format("GameData:/test/path{}", i);
+    paths->values().push_back(std::move(path));
+    map->values().emplace_back(ndf_generator::gen_random_uint32(-1),
+                             ndf_generator::gen_random_string(-1));
+  }
+  auto pair = std::make_unique<NDFPropertyPair>();
+  pair->property_name = "Pair";
+  pair->first = ndf_generator::gen_random_string(-1);
+  pair->second = ndf_generator::gen_import_reference(-1, "$/test/import0");
+  object.add_property(std::move(strings));
+  object.add_property(std::move(imports));
+  object.add_property(std::move(paths));
+  object.add_property(std::move(map));
+  object.add_property(std::move(pair));
+  ndf.add_object(std::move(object));
+  std::string original = save_to_string(ndf);
+
+  NDF copied;
+  {
+    NDF loaded;
+    std::stringstream stream(original);
+    loaded.load_from_ndfbin_stream(stream);
+    auto &loaded_object = loaded.get_object("Object_0");
+    for (int i = 0; i < 3; i++) {
+      REQUIRE(
+          static_cast<const NDFPropertyList &>(*loaded_object.properties()[i])
+              .is_packed());
+    }
+    REQUIRE(static_cast<const NDFPropertyMap &>(*loaded_object.properties()[3])
+                .is_packed());
+    REQUIRE(static_cast<const NDFPropertyPair &>(*loaded_object.properties()[4])
+                .is_packed());
+
+    copied.add_object(loaded_object.get_copy());
+    // the views into the tables of loaded become dangling here
+    loaded.clear();
+  }
+  auto &copy = copied.get_object("Object_0");
+  for (int i = 0; i < 3; i++) {
+    REQUIRE_FALSE(static_cast<const NDFPropertyList &>(*copy.properties()[i])
+                      .is_packed());
+  }
+  REQUIRE_FALSE(
+      static_cast<const NDFPropertyMap &>(*copy.properties()[3]).is_packed());
+  REQUIRE_FALSE(
+      static_cast<const NDFPropertyPair &>(*copy.properties()[4]).is_packed());
+  REQUIRE(save_to_string(copied) == original);
+}
+
+// not run by default, run with `tests "[benchmark]"`
+TEST_CASE("ndfbin save benchmark", "[.][benchmark]") {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, 100000);
+  BENCHMARK("save 100k objects") { return save_to_string(ndf); };
+}